@@ -1,11 +1,22 @@
 #include "AudioDecoder.h"
+#include "AudioKernels.h"
 #include "AudioUtils.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
 AudioDecoder::AudioDecoder()
     : fmt_ctx(nullptr), codec_ctx(nullptr), swr_ctx(nullptr),
-    packet(nullptr), frame(nullptr), audio_stream_index(-1) {
+    packet(nullptr), frame(nullptr), audio_stream_index(-1),
+    input_ended(false), decoder_ended(false),
+    out_sample_rate(48000), out_sample_fmt(AV_SAMPLE_FMT_S16),
+    passthrough_allowed(true), passthrough(false), rate_adjustable(false), rate_adjustment_ppm(0.0),
+    frame_offset(0), mixing(false), output_frames(0),
+    has_anchor(false), anchor_changed(false), anchor_pts(0.0), anchor_frame(0) {
+    av_channel_layout_default(&out_layout, 2);
 }
 
 AudioDecoder::~AudioDecoder() {
@@ -14,6 +25,24 @@ AudioDecoder::~AudioDecoder() {
     swr_free(&swr_ctx);
     avcodec_free_context(&codec_ctx);
     avformat_close_input(&fmt_ctx);
+    av_channel_layout_uninit(&out_layout);
+}
+
+void AudioDecoder::setOutputFormat(int sample_rate, int channels, AVSampleFormat sample_fmt) {
+    out_sample_rate = sample_rate > 0 ? sample_rate : 48000;
+    out_sample_fmt = sample_fmt;
+
+    // In the order SDL interleaves the device's channels
+    av_channel_layout_uninit(&out_layout);
+    GetDefaultChannelLayout(channels, &out_layout);
+}
+
+void AudioDecoder::setPassthroughAllowed(bool allowed) {
+    passthrough_allowed = allowed;
+}
+
+void AudioDecoder::enableRateAdjustment(bool enabled) {
+    rate_adjustable = enabled;
 }
 
 bool AudioDecoder::openFile(const std::string& filename) {
@@ -86,10 +115,6 @@ bool AudioDecoder::openFile(const std::string& filename) {
         return false;
     }
 
-    // SDL wants stereo, 48000Hz, 16-bit signed
-    AVChannelLayout out_layout;
-    av_channel_layout_default(&out_layout, 2);
-
     // Initialize swr
     swr_ctx = swr_alloc();
     if (!swr_ctx) {
@@ -100,8 +125,8 @@ bool AudioDecoder::openFile(const std::string& filename) {
     if (swr_alloc_set_opts2(
         &swr_ctx,
         &out_layout,
-        AV_SAMPLE_FMT_S16,
-        48000,
+        out_sample_fmt,
+        out_sample_rate,
         &codec_ctx->ch_layout,
         codec_ctx->sample_fmt,
         codec_ctx->sample_rate,
@@ -111,67 +136,410 @@ bool AudioDecoder::openFile(const std::string& filename) {
         return false;
     }
 
+    // Compensation needs the resampler even when the rates match
+    if (rate_adjustable) {
+        av_opt_set_int(swr_ctx, "flags", SWR_FLAG_RESAMPLE, 0);
+    }
+
     if (swr_init(swr_ctx) < 0) {
         std::cerr << "Failed to initialize resampler\n";
         return false;
     }
 
+    // Same rate: all that's left is interleaving, a sample format step and
+    // maybe a channel mix, which AudioKernels does without the resampler.
+    // Float sources go to any output; 32-bit integer ones to 32-bit outputs
+    // and only when the layout already matches
+    AVSampleFormat in_packed = av_get_packed_sample_fmt(codec_ctx->sample_fmt);
+    bool formats_supported = in_packed == AV_SAMPLE_FMT_FLT
+        ? (out_sample_fmt == AV_SAMPLE_FMT_FLT || out_sample_fmt == AV_SAMPLE_FMT_S16 || out_sample_fmt == AV_SAMPLE_FMT_S32)
+        : (in_packed == AV_SAMPLE_FMT_S32 && (out_sample_fmt == AV_SAMPLE_FMT_FLT || out_sample_fmt == AV_SAMPLE_FMT_S32));
+    passthrough = passthrough_allowed && !rate_adjustable && formats_supported
+        && codec_ctx->sample_rate == out_sample_rate
+        && codec_ctx->ch_layout.nb_channels <= kMaxPassthroughChannels
+        && out_layout.nb_channels <= kMaxPassthroughChannels;
+
+    // Containers that don't say which speaker is which get FFmpeg's
+    // default for the count, as swr would assume
+    AVChannelLayout source_layout = {};
+    if (codec_ctx->ch_layout.order == AV_CHANNEL_ORDER_UNSPEC) {
+        av_channel_layout_default(&source_layout, codec_ctx->ch_layout.nb_channels);
+    }
+    else {
+        av_channel_layout_copy(&source_layout, &codec_ctx->ch_layout);
+    }
+
+    // One noise sequence for the whole stream, so it runs on across frames
+    InitAudioDither(dither, (uint32_t)audio_stream_index + 1);
+
+    mixing = false;
+    if (passthrough && av_channel_layout_compare(&source_layout, &out_layout) != 0) {
+        passthrough = in_packed == AV_SAMPLE_FMT_FLT && setupMixMatrix(source_layout);
+        mixing = passthrough;
+    }
+
+    char in_name[128] = "?", out_name[128] = "?";
+    av_channel_layout_describe(&source_layout, in_name, sizeof(in_name));
+    av_channel_layout_describe(&out_layout, out_name, sizeof(out_name));
+    av_channel_layout_uninit(&source_layout);
+
+    std::cout << "Audio output: " << out_sample_rate << " Hz, " << out_name
+        << (strcmp(in_name, out_name) != 0 ? std::string(" (mixed from ") + in_name + ")" : std::string())
+        << ", " << av_get_sample_fmt_name(out_sample_fmt)
+        << (passthrough ? " (passthrough)"
+            : out_sample_rate == codec_ctx->sample_rate ? " (swresample, no resampling)" : " (resampled)")
+        << ", " << GetAudioKernelsName() << " kernels\n";
+
+    return true;
+}
+
+bool AudioDecoder::setupMixMatrix(const AVChannelLayout& source_layout) {
+    const int in_channels = source_layout.nb_channels;
+    const int out_channels = out_layout.nb_channels;
+
+    // The same matrix swr would build: -3 dB centre and surrounds, no LFE,
+    // normalised against clipping unless the output is float
+    const double kMinus3dB = 0.70710678118654752440;
+    double maxval = out_sample_fmt == AV_SAMPLE_FMT_FLT ? (double)INT_MAX : 1.0;
+    std::vector<double> matrix((size_t)out_channels * in_channels);
+    if (swr_build_matrix2(&source_layout, &out_layout, kMinus3dB, kMinus3dB, 0.0, maxval, 1.0,
+        matrix.data(), in_channels, AV_MATRIX_ENCODING_NONE, nullptr) < 0) {
+        return false; // exotic layout; swr will have to do it
+    }
+
+    mix_matrix.assign(matrix.begin(), matrix.end());
     return true;
 }
 
-bool AudioDecoder::decodeNextFrame(std::vector<uint8_t>& out_buffer) {
+bool AudioDecoder::decodeInto(AudioRingBuffer& ring, size_t target_bytes) {
+    if (passthrough) {
+        return decodeDirect(ring, target_bytes);
+    }
+
+    const size_t bytes_per_frame = (size_t)getBytesPerFrame();
+    size_t wanted = std::max<size_t>(std::min(target_bytes, ring.writeAvailable()) / bytes_per_frame, 1);
+
+    // Decoded frames only go into the resampler's input buffer here; they
+    // come out in one piece below
+    while (!decoder_ended && (size_t)swr_get_out_samples(swr_ctx, 0) < wanted) {
+        if (!receiveFrames()) {
+            return false;
+        }
+        if (!decoder_ended && !sendNextPacket()) {
+            return false;
+        }
+    }
+
+    size_t written = convertInto(ring);
+    if (written == 0 && decoder_ended && ring.writeAvailable() >= bytes_per_frame) {
+        return false; // room to spare and nothing came out: fully drained
+    }
+    return true;
+}
+
+bool AudioDecoder::receiveFrames() {
+    while (true) {
+        int ret = avcodec_receive_frame(codec_ctx, frame);
+        if (ret == AVERROR(EAGAIN)) {
+            return true; // needs another packet
+        }
+        if (ret == AVERROR_EOF) {
+            decoder_ended = true;
+            return true;
+        }
+        if (ret < 0) {
+            std::cerr << "Failed to decode audio frame\n";
+            return false;
+        }
+
+        // This frame's first sample comes out after everything swr holds
+        trackTimestamp(output_frames + (uint64_t)swr_get_delay(swr_ctx, out_sample_rate));
+
+        // out_count 0: swr keeps the input until convertInto() asks for it
+        ScopedStageTimer timer(convert_timing);
+        int buffered = swr_convert(swr_ctx, nullptr, 0, (const uint8_t**)frame->extended_data, frame->nb_samples);
+        av_frame_unref(frame);
+        if (buffered < 0) {
+            std::cerr << "Failed to convert audio samples\n";
+            return false;
+        }
+    }
+}
+
+bool AudioDecoder::sendNextPacket() {
+    if (input_ended) {
+        return true;
+    }
+
     while (av_read_frame(fmt_ctx, packet) >= 0) {
-        if (packet->stream_index == audio_stream_index) {
-            if (avcodec_send_packet(codec_ctx, packet) == 0) {
-                while (avcodec_receive_frame(codec_ctx, frame) == 0) {
-                    int out_channels = 2;
-                    int bytes_per_sample = av_get_bytes_per_sample(AV_SAMPLE_FMT_S16);
-                    int max_dst_nb_samples = av_rescale_rnd(
-                        swr_get_delay(swr_ctx, codec_ctx->sample_rate) + frame->nb_samples,
-                        48000, codec_ctx->sample_rate, AV_ROUND_UP);
-
-                    int total_size = max_dst_nb_samples * out_channels * bytes_per_sample;
-                    out_buffer.resize(total_size);
-
-                    uint8_t* out_ptrs[1] = { out_buffer.data() };
-
-                    int converted = swr_convert(
-                        swr_ctx,
-                        out_ptrs,
-                        max_dst_nb_samples,
-                        (const uint8_t**)frame->data,
-                        frame->nb_samples
-                    );
-
-                    if (converted < 0) {
-                        std::cerr << "Failed to convert audio samples\n";
-                        av_packet_unref(packet);
-                        return false;
-                    }
-
-                    // Resize buffer to match actual output size
-                    int used_size = converted * out_channels * bytes_per_sample;
-                    out_buffer.resize(used_size);
-
-                    av_packet_unref(packet);
-                    return true;
+        if (packet->stream_index != audio_stream_index) {
+            av_packet_unref(packet);
+            continue;
+        }
+
+        int ret = avcodec_send_packet(codec_ctx, packet);
+        av_packet_unref(packet);
+        if (ret < 0 && ret != AVERROR_INVALIDDATA) {
+            // receiveFrames() empties the codec before every send, so EAGAIN
+            // can't happen here; anything else is fatal
+            std::cerr << "Failed to send audio packet\n";
+            return false;
+        }
+        return true;
+    }
+
+    // End of file: a null packet makes the codec hand over what it delays
+    input_ended = true;
+    avcodec_send_packet(codec_ctx, nullptr);
+    return true;
+}
+
+size_t AudioDecoder::convertInto(AudioRingBuffer& ring) {
+    const size_t bytes_per_frame = (size_t)getBytesPerFrame();
+    // A null input array would flush the resampler's filter tail, which is
+    // only right at the very end; an empty one just drains what's buffered
+    const uint8_t* no_input[AV_NUM_DATA_POINTERS] = {};
+    size_t written = 0;
+    ScopedStageTimer timer(convert_timing);
+
+    while (true) {
+        int pending = swr_get_out_samples(swr_ctx, 0);
+        if (pending <= 0 && !decoder_ended) {
+            break;
+        }
+
+        size_t contiguous = 0;
+        uint8_t* dst = ring.acquireWrite(contiguous);
+        int room = (int)(contiguous / bytes_per_frame);
+        if (room == 0) {
+            break; // ring is full, the rest stays in swr
+        }
+
+        int converted = swr_convert(swr_ctx, &dst, room,
+            decoder_ended ? nullptr : no_input, 0);
+        if (converted <= 0) {
+            break;
+        }
+        ring.commitWrite((size_t)converted * bytes_per_frame);
+        written += (size_t)converted * bytes_per_frame;
+        output_frames += (uint64_t)converted;
+    }
+    return written;
+}
+
+bool AudioDecoder::decodeDirect(AudioRingBuffer& ring, size_t target_bytes) {
+    const size_t bytes_per_frame = (size_t)getBytesPerFrame();
+    size_t wanted = std::max(std::min(target_bytes, ring.writeAvailable()), bytes_per_frame);
+    size_t written = 0;
+
+    while (written < wanted) {
+        // 'frame' is kept until all of it has made it into the ring
+        if (frame_offset >= frame->nb_samples) {
+            av_frame_unref(frame);
+            frame_offset = 0;
+            if (decoder_ended) {
+                break;
+            }
+
+            int ret = avcodec_receive_frame(codec_ctx, frame);
+            if (ret == AVERROR(EAGAIN)) {
+                if (!sendNextPacket()) {
+                    return false;
                 }
+                continue;
+            }
+            if (ret == AVERROR_EOF) {
+                decoder_ended = true;
+                break;
             }
+            if (ret < 0) {
+                std::cerr << "Failed to decode audio frame\n";
+                return false;
+            }
+            trackTimestamp(output_frames);
+            continue;
         }
-        av_packet_unref(packet);
+
+        size_t copied = copyFrameInto(ring);
+        if (copied == 0) {
+            break; // ring is full
+        }
+        written += copied;
     }
 
-    return false;
+    if (written == 0 && decoder_ended && ring.writeAvailable() >= bytes_per_frame) {
+        return false;
+    }
+    return true;
+}
+
+size_t AudioDecoder::copyFrameInto(AudioRingBuffer& ring) {
+    const int bytes_per_frame = getBytesPerFrame();
+    const int channels = out_layout.nb_channels;
+
+    size_t contiguous = 0;
+    uint8_t* dst = ring.acquireWrite(contiguous);
+    int count = std::min(frame->nb_samples - frame_offset, (int)(contiguous / bytes_per_frame));
+    if (count <= 0) {
+        return 0;
+    }
+
+    ScopedStageTimer timer(convert_timing);
+    const int in_channels = codec_ctx->ch_layout.nb_channels;
+    bool planar = av_sample_fmt_is_planar(codec_ctx->sample_fmt) != 0;
+    const AVSampleFormat in_packed = av_get_packed_sample_fmt(codec_ctx->sample_fmt);
+    const size_t samples = (size_t)count * channels;
+
+    // Planar sources are read through per-channel pointers; the interleave
+    // kernels only move 32-bit words, so S32P goes through them too
+    const float* planes[kMaxPassthroughChannels];
+    const float* packed = nullptr;
+    if (planar) {
+        for (int c = 0; c < in_channels; ++c) {
+            planes[c] = (const float*)frame->extended_data[c] + frame_offset;
+        }
+    }
+    else {
+        packed = (const float*)frame->data[0] + (size_t)frame_offset * in_channels;
+    }
+
+    // Mixing works on planes: output planes first in the scratch buffer,
+    // then a packed source split into planes after them
+    if (mixing) {
+        size_t needed = (size_t)count * (channels + (planar ? 0 : in_channels));
+        if (mix_scratch.size() < needed) {
+            mix_scratch.resize(needed);
+        }
+        float* mixed[kMaxPassthroughChannels];
+        for (int c = 0; c < channels; ++c) {
+            mixed[c] = mix_scratch.data() + (size_t)c * count;
+        }
+        if (!planar) {
+            float* split[kMaxPassthroughChannels];
+            for (int c = 0; c < in_channels; ++c) {
+                split[c] = mix_scratch.data() + (size_t)(channels + c) * count;
+                planes[c] = split[c];
+            }
+            DeinterleaveFloat(packed, in_channels, (size_t)count, split);
+        }
+
+        MixChannels(planes, in_channels, mixed, channels, (size_t)count, mix_matrix.data());
+        for (int c = 0; c < channels; ++c) {
+            planes[c] = mixed[c];
+        }
+        planar = true;
+    }
+
+    if (out_sample_fmt == AV_SAMPLE_FMT_S16) {
+        // Float source only (see openFile). Dithered, so quiet passages
+        // get a noise floor instead of truncation distortion
+        if (planar) {
+            if (s16_scratch.size() < samples) {
+                s16_scratch.resize(samples);
+            }
+            InterleaveFloat(planes, channels, (size_t)count, s16_scratch.data());
+            packed = s16_scratch.data();
+        }
+        FloatToS16Dither(packed, samples, (int16_t*)dst, dither);
+    }
+    else {
+        // 32-bit in and out: put the words in place, then convert them
+        // there if the types differ
+        if (planar) {
+            InterleaveFloat(planes, channels, (size_t)count, (float*)dst);
+        }
+        else {
+            memcpy(dst, packed, samples * sizeof(float));
+        }
+
+        if (in_packed == AV_SAMPLE_FMT_FLT && out_sample_fmt == AV_SAMPLE_FMT_S32) {
+            FloatToS32((const float*)dst, samples, (int32_t*)dst);
+        }
+        else if (in_packed == AV_SAMPLE_FMT_S32 && out_sample_fmt == AV_SAMPLE_FMT_FLT) {
+            S32ToFloat((const int32_t*)dst, samples, (float*)dst);
+        }
+    }
+
+    size_t bytes = (size_t)count * bytes_per_frame;
+    ring.commitWrite(bytes);
+    frame_offset += count;
+    output_frames += (uint64_t)count;
+    return bytes;
 }
 
 int AudioDecoder::getSampleRate() const {
-    return 48000;
+    return out_sample_rate;
 }
 
 int AudioDecoder::getChannels() const {
-    return 2;
+    return out_layout.nb_channels;
 }
 
 AVSampleFormat AudioDecoder::getSampleFormat() const {
-    return AV_SAMPLE_FMT_S16;
-}
\ No newline at end of file
+    return out_sample_fmt;
+}
+
+int AudioDecoder::getBytesPerFrame() const {
+    return out_layout.nb_channels * av_get_bytes_per_sample(out_sample_fmt);
+}
+
+void AudioDecoder::trackTimestamp(uint64_t out_frame) {
+    int64_t ts = frame->best_effort_timestamp;
+    if (ts == AV_NOPTS_VALUE) {
+        return;
+    }
+    double pts = ts * av_q2d(fmt_ctx->streams[audio_stream_index]->time_base);
+
+    // Contiguous audio just continues the anchor; re-anchor past timestamp
+    // rounding. While the rate is adjusted, output frames no longer map to
+    // pts at the nominal rate, so every frame re-anchors with its exact
+    // position and the clock follows the stretch as it's applied.
+    double expected = anchor_pts + (double)(out_frame - anchor_frame) / out_sample_rate;
+    if (!has_anchor || rate_adjustable || std::fabs(pts - expected) > kReanchorSeconds) {
+        anchor_pts = pts;
+        anchor_frame = out_frame;
+        has_anchor = true;
+        anchor_changed = true;
+    }
+}
+
+bool AudioDecoder::takeTimestampAnchor(double& pts, uint64_t& frame_index) {
+    if (!anchor_changed) {
+        return false;
+    }
+    anchor_changed = false;
+    pts = anchor_pts;
+    frame_index = anchor_frame;
+    return true;
+}
+
+bool AudioDecoder::setRateAdjustment(double ppm) {
+    if (!rate_adjustable || !swr_ctx) {
+        return false;
+    }
+
+    int distance = out_sample_rate * kRateAdjustmentSeconds;
+    int delta = (int)std::lrint(ppm * 1e-6 * distance);
+    if (swr_set_compensation(swr_ctx, delta, distance) < 0) {
+        std::cerr << "Failed to set audio rate compensation\n";
+        return false;
+    }
+    rate_adjustment_ppm = delta * 1e6 / distance; // what the rounding left
+    return true;
+}
+
+double AudioDecoder::getRateAdjustment() const {
+    return rate_adjustment_ppm;
+}
+
+bool AudioDecoder::isPassthrough() const {
+    return passthrough;
+}
+
+const StageTiming& AudioDecoder::getConvertTiming() const {
+    return convert_timing;
+}
+
+double AudioDecoder::getOutputSeconds() const {
+    return (double)output_frames / out_sample_rate;
+}
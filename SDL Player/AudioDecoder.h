@@ -14,25 +14,118 @@ extern "C" {
 #include <string>
 #include <vector>
 
+#include "AudioKernels.h"
+#include "AudioRingBuffer.h"
+#include "PlaybackStats.h"
+
 class AudioDecoder {
 public:
     AudioDecoder();
     ~AudioDecoder();
 
+    /// Output format the resampler is set up to produce, normally the audio
+    /// device's native spec so nothing downstream converts again. Call before
+    /// openFile(); defaults to 48000 Hz stereo S16. A matching source rate is
+    /// passed through without resampling. The channel layout is the one SDL
+    /// uses for 'channels', so surround stays surround on a surround device
+    /// and anything else is mixed to fit.
+    void setOutputFormat(int sample_rate, int channels, AVSampleFormat sample_fmt);
+
+    /// When the source rate already matches the output, frames are
+    /// interleaved/converted by AudioKernels instead of going through swr
+    /// (float or 32-bit integer sources, planar or packed). Float sources
+    /// with a different layout are up/downmixed there too, with a matrix
+    /// worked out once in openFile().
+    /// On by default; turning it off (before openFile) is for comparison.
+    void setPassthroughAllowed(bool allowed);
+
+    /// Keeps the resampler in the path (even at matching rates, and instead
+    /// of the passthrough) so setRateAdjustment() can be used. Call before
+    /// openFile().
+    void enableRateAdjustment(bool enabled);
+
+    /// Plays the source 'ppm' parts per million slower (positive: more
+    /// output samples per input) or faster, via swr_set_compensation, to
+    /// follow an external clock without dropping or repeating buffers. The
+    /// adjustment lapses after kRateAdjustmentSeconds unless renewed.
+    bool setRateAdjustment(double ppm);
+    double getRateAdjustment() const;
+
     bool openFile(const std::string& filename);
-    bool decodeNextFrame(std::vector<uint8_t>& out_buffer);
+
+    /// Decodes until about 'target_bytes' of output are pending (or the ring
+    /// is full), then converts all of it with one swr_convert() written
+    /// straight into the ring's free space; two calls when the span wraps.
+    /// Every frame the codec produces is collected, so no packet is ever
+    /// refused. Whatever didn't fit stays in the resampler for next time.
+    /// Returns false once the stream is fully drained, or on error.
+    bool decodeInto(AudioRingBuffer& ring, size_t target_bytes);
 
     int getSampleRate() const;
     int getChannels() const;
     AVSampleFormat getSampleFormat() const;
+    int getBytesPerFrame() const; // one sample for every channel, interleaved
+
+    /// Timestamp of the output: pts of output frame 'frame' (counted from
+    /// the first one written). True when it's new since the last call, i.e.
+    /// at the start and after the source timestamps jump.
+    bool takeTimestampAnchor(double& pts, uint64_t& frame_index);
+
+    bool isPassthrough() const;
+    const StageTiming& getConvertTiming() const; // swr or kernel time per batch
+    double getOutputSeconds() const;             // audio produced so far
 
 private:
+    bool sendNextPacket();
+    bool receiveFrames();
+    size_t convertInto(AudioRingBuffer& ring);
+    bool decodeDirect(AudioRingBuffer& ring, size_t target_bytes);
+    size_t copyFrameInto(AudioRingBuffer& ring);
+    void trackTimestamp(uint64_t out_frame);
+
+    bool setupMixMatrix(const AVChannelLayout& source_layout);
+
+    static const int kMaxPassthroughChannels = 64; // 22.2 and friends fit
+    // Spread over this much output, one sample of correction is ~2 ppm at 48 kHz
+    static const int kRateAdjustmentSeconds = 10;
+    static constexpr double kReanchorSeconds = 0.005; // timestamp error tolerated at the nominal rate
+
     AVFormatContext* fmt_ctx;
     AVCodecContext* codec_ctx;
     SwrContext* swr_ctx;
     AVPacket* packet;
     AVFrame* frame;
     int audio_stream_index;
+    bool input_ended;   // demuxer is done, the codec has been sent its flush packet
+    bool decoder_ended; // codec returned AVERROR_EOF; only the resampler holds samples
+
+    int out_sample_rate;
+    AVChannelLayout out_layout;
+    AVSampleFormat out_sample_fmt;
+
+    bool passthrough_allowed;
+    bool passthrough;
+    bool rate_adjustable;
+    double rate_adjustment_ppm;
+    int frame_offset; // samples of 'frame' already written (passthrough only)
+
+    // Passthrough up/downmix: out_channels x in_channels, row-major
+    bool mixing;
+    std::vector<float> mix_matrix;
+    std::vector<float> mix_scratch; // mixed (and split-out) planes; grows to the largest frame
+
+    // S16 passthrough: interleaved float ahead of the dithered conversion
+    AudioDither dither;
+    std::vector<float> s16_scratch;
+
+    StageTiming convert_timing;
+    uint64_t output_frames;
+
+    // Where the output sits on the source timeline
+    bool has_anchor;
+    bool anchor_changed;
+    double anchor_pts;
+    uint64_t anchor_frame;
 };
 
 #endif // AUDIO_DECODER_H
\ No newline at end of file
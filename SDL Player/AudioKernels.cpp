@@ -0,0 +1,244 @@
+#include "AudioKernels.h"
+#include "AudioKernelsImpl.h"
+
+#if defined(AUDIO_KERNELS_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace AudioScalar {
+    void interleaveFloat(const float* const* planes, int channels, size_t frames, float* dst) {
+        // Channel by channel keeps each source read sequential
+        for (int c = 0; c < channels; ++c) {
+            const float* src = planes[c];
+            float* out = dst + c;
+            for (size_t i = 0; i < frames; ++i) {
+                out[i * channels] = src[i];
+            }
+        }
+    }
+
+    void deinterleaveFloat(const float* src, int channels, size_t frames, float* const* planes) {
+        for (int c = 0; c < channels; ++c) {
+            const float* in = src + c;
+            float* out = planes[c];
+            for (size_t i = 0; i < frames; ++i) {
+                out[i] = in[i * channels];
+            }
+        }
+    }
+
+    void interleaveFloatToS16(const float* const* planes, int channels, size_t frames, int16_t* dst) {
+        for (int c = 0; c < channels; ++c) {
+            const float* src = planes[c];
+            int16_t* out = dst + c;
+            for (size_t i = 0; i < frames; ++i) {
+                out[i * channels] = toS16(src[i]);
+            }
+        }
+    }
+
+    void floatToS16(const float* src, size_t count, int16_t* dst) {
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = toS16(src[i]);
+        }
+    }
+
+    void floatToS32(const float* src, size_t count, int32_t* dst) {
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = toS32(src[i]);
+        }
+    }
+
+    void s32ToFloat(const int32_t* src, size_t count, float* dst) {
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = (float)src[i] * (1.0f / 2147483648.0f);
+        }
+    }
+
+    void floatToS16Dither(const float* src, size_t count, int16_t* dst, AudioDither& dither) {
+        uint32_t& a = dither.state[0];
+        uint32_t& b = dither.state[8];
+        for (size_t i = 0; i < count; ++i) {
+            float noise = unitFromBits(nextRandom(a)) - unitFromBits(nextRandom(b));
+            float scaled = src[i] * 32768.0f + noise;
+            scaled = scaled == scaled ? scaled : 0.0f;
+            scaled = scaled < -32768.0f ? -32768.0f : (scaled > 32767.0f ? 32767.0f : scaled);
+            dst[i] = (int16_t)std::lrint(scaled);
+        }
+    }
+
+    void applyGainRamp(float* samples, int channels, size_t frames, float gain_from, float gain_to) {
+        if (frames == 0) {
+            return;
+        }
+        float step = (gain_to - gain_from) / (float)frames;
+        for (size_t i = 0; i < frames; ++i) {
+            float gain = gain_from + step * (float)i;
+            float* frame = samples + i * channels;
+            for (int c = 0; c < channels; ++c) {
+                frame[c] *= gain;
+            }
+        }
+    }
+
+    void mixChannels(const float* const* in_planes, int in_channels,
+        float* const* out_planes, int out_channels, size_t frames, const float* matrix) {
+        for (int o = 0; o < out_channels; ++o) {
+            const float* row = matrix + o * in_channels;
+            float* out = out_planes[o];
+            for (size_t i = 0; i < frames; ++i) {
+                float sum = 0.0f;
+                for (int c = 0; c < in_channels; ++c) {
+                    sum += row[c] * in_planes[c][i];
+                }
+                out[i] = sum;
+            }
+        }
+    }
+}
+
+void FillScalarKernels(AudioKernelTable& table) {
+    table.name = "scalar";
+    table.interleaveFloat = AudioScalar::interleaveFloat;
+    table.deinterleaveFloat = AudioScalar::deinterleaveFloat;
+    table.interleaveFloatToS16 = AudioScalar::interleaveFloatToS16;
+    table.floatToS16 = AudioScalar::floatToS16;
+    table.floatToS32 = AudioScalar::floatToS32;
+    table.s32ToFloat = AudioScalar::s32ToFloat;
+    table.floatToS16Dither = AudioScalar::floatToS16Dither;
+    table.applyGainRamp = AudioScalar::applyGainRamp;
+    table.mixChannels = AudioScalar::mixChannels;
+}
+
+#ifdef AUDIO_KERNELS_X86
+// AVX2 needs the CPU to support it and the OS to save the YMM registers
+static bool cpuHasAvx2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static bool cpuHasSse2() {
+#if defined(_M_X64) || defined(__x86_64__)
+    return true;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+#endif
+}
+#endif
+
+static AudioKernelTable selectKernels() {
+    AudioKernelTable table;
+    FillScalarKernels(table);
+#ifdef AUDIO_KERNELS_X86
+    if (cpuHasSse2()) {
+        FillSse2Kernels(table);
+        if (cpuHasAvx2()) {
+            FillAvx2Kernels(table);
+        }
+    }
+#endif
+#if defined(AUDIO_KERNELS_NEON) && defined(AUDIO_KERNELS_ENABLE_NEON)
+    FillNeonKernels(table); // baseline on ARM64
+#endif
+    return table;
+}
+
+int GetAvailableAudioKernels(AudioKernelTable* tables, int max_tables) {
+    int count = 0;
+    if (count < max_tables) {
+        FillScalarKernels(tables[count++]);
+    }
+#ifdef AUDIO_KERNELS_X86
+    if (cpuHasSse2() && count < max_tables) {
+        tables[count] = tables[count - 1];
+        FillSse2Kernels(tables[count++]);
+    }
+    if (cpuHasSse2() && cpuHasAvx2() && count < max_tables) {
+        tables[count] = tables[count - 1];
+        FillAvx2Kernels(tables[count++]);
+    }
+#endif
+#ifdef AUDIO_KERNELS_NEON
+    if (count < max_tables) {
+        tables[count] = tables[0];
+        FillNeonKernels(tables[count++]);
+    }
+#endif
+    return count;
+}
+
+static const AudioKernelTable& kernels() {
+    static const AudioKernelTable table = selectKernels();
+    return table;
+}
+
+void InitAudioDither(AudioDither& dither, uint32_t seed) {
+    // Distinct, never-zero seeds per lane (xorshift stays at zero forever)
+    uint32_t x = seed ? seed : 0x9e3779b9u;
+    for (int i = 0; i < 16; ++i) {
+        x = x * 1664525u + 1013904223u;
+        dither.state[i] = x ? x : 1u;
+    }
+}
+
+const char* GetAudioKernelsName() {
+    return kernels().name;
+}
+
+void InterleaveFloat(const float* const* planes, int channels, size_t frames, float* dst) {
+    kernels().interleaveFloat(planes, channels, frames, dst);
+}
+
+void DeinterleaveFloat(const float* src, int channels, size_t frames, float* const* planes) {
+    kernels().deinterleaveFloat(src, channels, frames, planes);
+}
+
+void InterleaveFloatToS16(const float* const* planes, int channels, size_t frames, int16_t* dst) {
+    kernels().interleaveFloatToS16(planes, channels, frames, dst);
+}
+
+void FloatToS16(const float* src, size_t count, int16_t* dst) {
+    kernels().floatToS16(src, count, dst);
+}
+
+void FloatToS32(const float* src, size_t count, int32_t* dst) {
+    kernels().floatToS32(src, count, dst);
+}
+
+void S32ToFloat(const int32_t* src, size_t count, float* dst) {
+    kernels().s32ToFloat(src, count, dst);
+}
+
+void FloatToS16Dither(const float* src, size_t count, int16_t* dst, AudioDither& dither) {
+    kernels().floatToS16Dither(src, count, dst, dither);
+}
+
+void ApplyGainRamp(float* samples, int channels, size_t frames, float gain_from, float gain_to) {
+    kernels().applyGainRamp(samples, channels, frames, gain_from, gain_to);
+}
+
+void MixChannels(const float* const* in_planes, int in_channels,
+    float* const* out_planes, int out_channels, size_t frames, const float* matrix) {
+    kernels().mixChannels(in_planes, in_channels, out_planes, out_channels, frames, matrix);
+}
@@ -0,0 +1,57 @@
+#ifndef AUDIO_KERNELS_H
+#define AUDIO_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/// Sample format, layout and gain loops for the audio path. The best
+/// implementation the CPU supports is picked once, on first use: AVX2 or
+/// SSE2 on x86 (SSE2 is always there on x64), NEON on ARM64 when built with
+/// AUDIO_KERNELS_ENABLE_NEON, plain C++ anywhere else. Results are the same
+/// on every path apart from float rounding in the mixing and gain kernels,
+/// and the dither noise sequence; Tests/ checks each path against plain C++.
+///
+/// Float to integer conversions match swresample: scale by 2^15 or 2^31,
+/// round to nearest and saturate. NaN converts to 0. Element-wise
+/// conversions between types of the same size may run in place (src == dst).
+
+/// State for FloatToS16Dither(); keep one per stream so the noise continues
+/// across calls.
+struct AudioDither {
+    uint32_t state[16];
+};
+
+void InitAudioDither(AudioDither& dither, uint32_t seed);
+
+/// Name of the implementation in use ("avx2", "sse2", "neon" or "scalar").
+const char* GetAudioKernelsName();
+
+/// Planar to interleaved and back. 'planes' holds one pointer per channel.
+/// These only move 32-bit words, so they work for int32 samples as well.
+void InterleaveFloat(const float* const* planes, int channels, size_t frames, float* dst);
+void DeinterleaveFloat(const float* src, int channels, size_t frames, float* const* planes);
+
+/// Planar float to interleaved S16.
+void InterleaveFloatToS16(const float* const* planes, int channels, size_t frames, int16_t* dst);
+
+/// 'count' samples between float and integer formats.
+void FloatToS16(const float* src, size_t count, int16_t* dst);
+void FloatToS32(const float* src, size_t count, int32_t* dst);
+void S32ToFloat(const int32_t* src, size_t count, float* dst);
+
+/// Float to S16 with triangular (TPDF) dither of one LSB, which turns the
+/// truncation error of quiet passages into a flat noise floor.
+void FloatToS16Dither(const float* src, size_t count, int16_t* dst, AudioDither& dither);
+
+/// Multiplies interleaved samples by a gain that moves linearly from
+/// 'gain_from' at the first frame towards 'gain_to' (reached at frame
+/// 'frames'), so volume changes don't click.
+void ApplyGainRamp(float* samples, int channels, size_t frames, float gain_from, float gain_to);
+
+/// Planar channel mix: out[o] = sum of matrix[o * in_channels + i] * in[i],
+/// for up/downmixing with a precomputed matrix. Output planes must not
+/// alias the input ones.
+void MixChannels(const float* const* in_planes, int in_channels,
+    float* const* out_planes, int out_channels, size_t frames, const float* matrix);
+
+#endif // AUDIO_KERNELS_H
@@ -0,0 +1,234 @@
+#include "AudioKernelsImpl.h"
+
+#ifdef AUDIO_KERNELS_X86
+#include <immintrin.h>
+
+// Only called after the CPU check in AudioKernels.cpp. MSVC accepts AVX2
+// intrinsics in any file; GCC and Clang need them enabled per function.
+#if defined(__GNUC__) && !defined(__AVX2__)
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define AVX2_TARGET
+#endif
+
+AVX2_TARGET static inline __m256 zeroNaN(__m256 x) {
+    return _mm256_and_ps(x, _mm256_cmp_ps(x, x, _CMP_ORD_Q));
+}
+
+AVX2_TARGET static inline __m256i scaleToS16(__m256 samples) {
+    const __m256 lo = _mm256_set1_ps(-32768.0f);
+    const __m256 hi = _mm256_set1_ps(32767.0f);
+    return _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(zeroNaN(_mm256_mul_ps(samples, _mm256_set1_ps(32768.0f))), lo), hi));
+}
+
+// packs_epi32 works within each 128-bit lane; this puts the halves back in order
+AVX2_TARGET static inline __m256i packS16(__m256i first, __m256i second) {
+    return _mm256_permute4x64_epi64(_mm256_packs_epi32(first, second), _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+AVX2_TARGET static inline __m256i nextRandom(__m256i x) {
+    x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 13));
+    x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 17));
+    return _mm256_xor_si256(x, _mm256_slli_epi32(x, 5));
+}
+
+AVX2_TARGET static inline __m256 unitFromBits(__m256i bits) {
+    return _mm256_castsi256_ps(_mm256_or_si256(_mm256_srli_epi32(bits, 9), _mm256_set1_epi32(0x3f800000)));
+}
+
+// Eight stereo frames: l0..l7 and r0..r7 to l0 r0 .. l3 r3 and l4 r4 .. l7 r7
+AVX2_TARGET static inline void zipStereo(__m256 l, __m256 r, __m256& first, __m256& second) {
+    __m256 lo = _mm256_unpacklo_ps(l, r); // l0 r0 l1 r1 | l4 r4 l5 r5
+    __m256 hi = _mm256_unpackhi_ps(l, r); // l2 r2 l3 r3 | l6 r6 l7 r7
+    first = _mm256_permute2f128_ps(lo, hi, 0x20);
+    second = _mm256_permute2f128_ps(lo, hi, 0x31);
+}
+
+AVX2_TARGET static void interleaveFloat(const float* const* planes, int channels, size_t frames, float* dst) {
+    if (channels != 2) {
+        AudioScalar::interleaveFloat(planes, channels, frames, dst);
+        return;
+    }
+    const float* left = planes[0];
+    const float* right = planes[1];
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        __m256 first, second;
+        zipStereo(_mm256_loadu_ps(left + i), _mm256_loadu_ps(right + i), first, second);
+        _mm256_storeu_ps(dst + 2 * i, first);
+        _mm256_storeu_ps(dst + 2 * i + 8, second);
+    }
+    _mm256_zeroupper();
+    const float* tail[2] = { left + i, right + i };
+    AudioScalar::interleaveFloat(tail, 2, frames - i, dst + 2 * i);
+}
+
+AVX2_TARGET static void deinterleaveFloat(const float* src, int channels, size_t frames, float* const* planes) {
+    if (channels != 2) {
+        AudioScalar::deinterleaveFloat(src, channels, frames, planes);
+        return;
+    }
+    float* left = planes[0];
+    float* right = planes[1];
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        __m256 a = _mm256_loadu_ps(src + 2 * i);     // l0 r0 l1 r1 l2 r2 l3 r3
+        __m256 b = _mm256_loadu_ps(src + 2 * i + 8); // l4 r4 .. l7 r7
+        // Per lane: l0 l1 l4 l5 | l2 l3 l6 l7, then swap the middle pairs
+        __m256 l = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 r = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm256_storeu_ps(left + i, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(l), _MM_SHUFFLE(3, 1, 2, 0))));
+        _mm256_storeu_ps(right + i, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(r), _MM_SHUFFLE(3, 1, 2, 0))));
+    }
+    _mm256_zeroupper();
+    float* tail[2] = { left + i, right + i };
+    AudioScalar::deinterleaveFloat(src + 2 * i, 2, frames - i, tail);
+}
+
+AVX2_TARGET static void interleaveFloatToS16(const float* const* planes, int channels, size_t frames, int16_t* dst) {
+    if (channels != 2) {
+        AudioScalar::interleaveFloatToS16(planes, channels, frames, dst);
+        return;
+    }
+    const float* left = planes[0];
+    const float* right = planes[1];
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        __m256 first, second;
+        zipStereo(_mm256_loadu_ps(left + i), _mm256_loadu_ps(right + i), first, second);
+        _mm256_storeu_si256((__m256i*)(dst + 2 * i), packS16(scaleToS16(first), scaleToS16(second)));
+    }
+    _mm256_zeroupper();
+    const float* tail[2] = { left + i, right + i };
+    AudioScalar::interleaveFloatToS16(tail, 2, frames - i, dst + 2 * i);
+}
+
+AVX2_TARGET static void floatToS16(const float* src, size_t count, int16_t* dst) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i first = scaleToS16(_mm256_loadu_ps(src + i));
+        __m256i second = scaleToS16(_mm256_loadu_ps(src + i + 8));
+        _mm256_storeu_si256((__m256i*)(dst + i), packS16(first, second));
+    }
+    _mm256_zeroupper();
+    AudioScalar::floatToS16(src + i, count - i, dst + i);
+}
+
+AVX2_TARGET static void floatToS32(const float* src, size_t count, int32_t* dst) {
+    const __m256 scale = _mm256_set1_ps(2147483648.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // Same overflow fix-up as the SSE2 version
+        __m256 scaled = zeroNaN(_mm256_mul_ps(_mm256_loadu_ps(src + i), scale));
+        __m256i overflow = _mm256_castps_si256(_mm256_cmp_ps(scaled, scale, _CMP_GE_OQ));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_xor_si256(_mm256_cvtps_epi32(scaled), overflow));
+    }
+    _mm256_zeroupper();
+    AudioScalar::floatToS32(src + i, count - i, dst + i);
+}
+
+AVX2_TARGET static void s32ToFloat(const int32_t* src, size_t count, float* dst) {
+    const __m256 scale = _mm256_set1_ps(1.0f / 2147483648.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i samples = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(samples), scale));
+    }
+    _mm256_zeroupper();
+    AudioScalar::s32ToFloat(src + i, count - i, dst + i);
+}
+
+AVX2_TARGET static void floatToS16Dither(const float* src, size_t count, int16_t* dst, AudioDither& dither) {
+    __m256i a = _mm256_loadu_si256((const __m256i*)dither.state);
+    __m256i b = _mm256_loadu_si256((const __m256i*)(dither.state + 8));
+    const __m256 lo = _mm256_set1_ps(-32768.0f);
+    const __m256 hi = _mm256_set1_ps(32767.0f);
+    const __m256 scale = _mm256_set1_ps(32768.0f);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i packed[2];
+        for (int half = 0; half < 2; ++half) {
+            a = nextRandom(a);
+            b = nextRandom(b);
+            __m256 noise = _mm256_sub_ps(unitFromBits(a), unitFromBits(b));
+            __m256 scaled = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i + 8 * half), scale), noise);
+            packed[half] = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(zeroNaN(scaled), lo), hi));
+        }
+        _mm256_storeu_si256((__m256i*)(dst + i), packS16(packed[0], packed[1]));
+    }
+
+    _mm256_storeu_si256((__m256i*)dither.state, a);
+    _mm256_storeu_si256((__m256i*)(dither.state + 8), b);
+    _mm256_zeroupper();
+    AudioScalar::floatToS16Dither(src + i, count - i, dst + i, dither);
+}
+
+AVX2_TARGET static void applyGainRamp(float* samples, int channels, size_t frames, float gain_from, float gain_to) {
+    if ((channels != 1 && channels != 2) || frames == 0) {
+        AudioScalar::applyGainRamp(samples, channels, frames, gain_from, gain_to);
+        return;
+    }
+
+    float step = (gain_to - gain_from) / (float)frames;
+    const __m256 index = channels == 1
+        ? _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f)
+        : _mm256_setr_ps(0.0f, 0.0f, 1.0f, 1.0f, 2.0f, 2.0f, 3.0f, 3.0f);
+    const size_t frames_per_vector = 8 / channels;
+    const __m256 from = _mm256_set1_ps(gain_from);
+    const __m256 step8 = _mm256_set1_ps(step);
+
+    size_t i = 0;
+    for (; i + frames_per_vector <= frames; i += frames_per_vector) {
+        __m256 frame = _mm256_add_ps(_mm256_set1_ps((float)i), index);
+        __m256 gain = _mm256_add_ps(from, _mm256_mul_ps(step8, frame));
+        float* p = samples + i * channels;
+        _mm256_storeu_ps(p, _mm256_mul_ps(_mm256_loadu_ps(p), gain));
+    }
+    _mm256_zeroupper();
+    for (; i < frames; ++i) {
+        float gain = gain_from + step * (float)i;
+        for (int c = 0; c < channels; ++c) {
+            samples[i * channels + c] *= gain;
+        }
+    }
+}
+
+AVX2_TARGET static void mixChannels(const float* const* in_planes, int in_channels,
+    float* const* out_planes, int out_channels, size_t frames, const float* matrix) {
+    for (int o = 0; o < out_channels; ++o) {
+        const float* row = matrix + o * in_channels;
+        float* out = out_planes[o];
+        size_t i = 0;
+        for (; i + 8 <= frames; i += 8) {
+            __m256 sum = _mm256_setzero_ps();
+            for (int c = 0; c < in_channels; ++c) {
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(row[c]), _mm256_loadu_ps(in_planes[c] + i)));
+            }
+            _mm256_storeu_ps(out + i, sum);
+        }
+        for (; i < frames; ++i) {
+            float sum = 0.0f;
+            for (int c = 0; c < in_channels; ++c) {
+                sum += row[c] * in_planes[c][i];
+            }
+            out[i] = sum;
+        }
+    }
+    _mm256_zeroupper();
+}
+
+void FillAvx2Kernels(AudioKernelTable& table) {
+    table.name = "avx2";
+    table.interleaveFloat = interleaveFloat;
+    table.deinterleaveFloat = deinterleaveFloat;
+    table.interleaveFloatToS16 = interleaveFloatToS16;
+    table.floatToS16 = floatToS16;
+    table.floatToS32 = floatToS32;
+    table.s32ToFloat = s32ToFloat;
+    table.floatToS16Dither = floatToS16Dither;
+    table.applyGainRamp = applyGainRamp;
+    table.mixChannels = mixChannels;
+}
+
+#endif // AUDIO_KERNELS_X86
@@ -0,0 +1,93 @@
+#ifndef AUDIO_KERNELS_IMPL_H
+#define AUDIO_KERNELS_IMPL_H
+
+#include "AudioKernels.h"
+#include <cmath>
+#include <cstdint>
+
+// Internal to the AudioKernels*.cpp files. Each instruction set fills in
+// the entries it has a faster version of, on top of the level below it.
+struct AudioKernelTable {
+    const char* name;
+    void (*interleaveFloat)(const float* const* planes, int channels, size_t frames, float* dst);
+    void (*deinterleaveFloat)(const float* src, int channels, size_t frames, float* const* planes);
+    void (*interleaveFloatToS16)(const float* const* planes, int channels, size_t frames, int16_t* dst);
+    void (*floatToS16)(const float* src, size_t count, int16_t* dst);
+    void (*floatToS32)(const float* src, size_t count, int32_t* dst);
+    void (*s32ToFloat)(const int32_t* src, size_t count, float* dst);
+    void (*floatToS16Dither)(const float* src, size_t count, int16_t* dst, AudioDither& dither);
+    void (*applyGainRamp)(float* samples, int channels, size_t frames, float gain_from, float gain_to);
+    void (*mixChannels)(const float* const* in_planes, int in_channels,
+        float* const* out_planes, int out_channels, size_t frames, const float* matrix);
+};
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define AUDIO_KERNELS_X86 1
+#endif
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+#define AUDIO_KERNELS_NEON 1
+#endif
+
+// Scalar helpers shared by the vector versions for their tails
+namespace AudioScalar {
+    inline int16_t toS16(float sample) {
+        float scaled = sample * 32768.0f;
+        scaled = scaled == scaled ? scaled : 0.0f; // NaN is silence, as the SIMD paths
+        scaled = scaled < -32768.0f ? -32768.0f : (scaled > 32767.0f ? 32767.0f : scaled);
+        return (int16_t)std::lrint(scaled); // nearest-even, as the SIMD paths
+    }
+
+    inline int32_t toS32(float sample) {
+        // 2^31 itself doesn't fit, so full scale saturates explicitly
+        float scaled = sample * 2147483648.0f;
+        if (scaled != scaled) return 0;
+        if (scaled >= 2147483648.0f) return INT32_MAX;
+        if (scaled <= -2147483648.0f) return INT32_MIN;
+        return (int32_t)std::lrint(scaled);
+    }
+
+    inline uint32_t nextRandom(uint32_t& x) { // xorshift32
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        return x;
+    }
+
+    // Top 23 bits as a float in [1, 2); the difference of two is triangular
+    // in (-1, 1)
+    inline float unitFromBits(uint32_t bits) {
+        union { uint32_t u; float f; } value;
+        value.u = (bits >> 9) | 0x3f800000u;
+        return value.f;
+    }
+
+    // The plain C++ kernels, also used by the vector versions for channel
+    // counts they don't specialise
+    void interleaveFloat(const float* const* planes, int channels, size_t frames, float* dst);
+    void deinterleaveFloat(const float* src, int channels, size_t frames, float* const* planes);
+    void interleaveFloatToS16(const float* const* planes, int channels, size_t frames, int16_t* dst);
+    void floatToS16(const float* src, size_t count, int16_t* dst);
+    void floatToS32(const float* src, size_t count, int32_t* dst);
+    void s32ToFloat(const int32_t* src, size_t count, float* dst);
+    void floatToS16Dither(const float* src, size_t count, int16_t* dst, AudioDither& dither);
+    void applyGainRamp(float* samples, int channels, size_t frames, float gain_from, float gain_to);
+    void mixChannels(const float* const* in_planes, int in_channels,
+        float* const* out_planes, int out_channels, size_t frames, const float* matrix);
+}
+
+void FillScalarKernels(AudioKernelTable& table);
+#ifdef AUDIO_KERNELS_X86
+void FillSse2Kernels(AudioKernelTable& table);
+void FillAvx2Kernels(AudioKernelTable& table);
+#endif
+#ifdef AUDIO_KERNELS_NEON
+void FillNeonKernels(AudioKernelTable& table);
+#endif
+
+// Every table this build and CPU can run, scalar first, each layered the
+// way dispatch would layer it. Includes NEON even while dispatch leaves it
+// off, so Tests/ can check it against scalar. Returns the number filled.
+int GetAvailableAudioKernels(AudioKernelTable* tables, int max_tables);
+
+#endif // AUDIO_KERNELS_IMPL_H
@@ -0,0 +1,113 @@
+#include "AudioKernelsImpl.h"
+
+#ifdef AUDIO_KERNELS_NEON
+#include <arm_neon.h>
+
+// ARM64 always has NEON, so these replace the scalar kernels outright.
+// Only the hot passthrough and mixing loops are vectorised so far; the rest
+// fall through to the scalar table.
+//
+// Not used by dispatch until the Tests/ equivalence run has passed on ARM
+// hardware; build with AUDIO_KERNELS_ENABLE_NEON to switch it on.
+
+static inline int32x4_t scaleToS16(float32x4_t samples) {
+    float32x4_t scaled = vmulq_n_f32(samples, 32768.0f);
+    scaled = vminq_f32(vmaxq_f32(scaled, vdupq_n_f32(-32768.0f)), vdupq_n_f32(32767.0f));
+    return vcvtnq_s32_f32(scaled); // round to nearest even; NaN (kept by min/max) to 0
+}
+
+static void interleaveFloat(const float* const* planes, int channels, size_t frames, float* dst) {
+    if (channels != 2) {
+        AudioScalar::interleaveFloat(planes, channels, frames, dst);
+        return;
+    }
+    const float* left = planes[0];
+    const float* right = planes[1];
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        float32x4x2_t zipped = { { vld1q_f32(left + i), vld1q_f32(right + i) } };
+        vst2q_f32(dst + 2 * i, zipped);
+    }
+    const float* tail[2] = { left + i, right + i };
+    AudioScalar::interleaveFloat(tail, 2, frames - i, dst + 2 * i);
+}
+
+static void deinterleaveFloat(const float* src, int channels, size_t frames, float* const* planes) {
+    if (channels != 2) {
+        AudioScalar::deinterleaveFloat(src, channels, frames, planes);
+        return;
+    }
+    float* left = planes[0];
+    float* right = planes[1];
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        float32x4x2_t split = vld2q_f32(src + 2 * i);
+        vst1q_f32(left + i, split.val[0]);
+        vst1q_f32(right + i, split.val[1]);
+    }
+    float* tail[2] = { left + i, right + i };
+    AudioScalar::deinterleaveFloat(src + 2 * i, 2, frames - i, tail);
+}
+
+static void interleaveFloatToS16(const float* const* planes, int channels, size_t frames, int16_t* dst) {
+    if (channels != 2) {
+        AudioScalar::interleaveFloatToS16(planes, channels, frames, dst);
+        return;
+    }
+    const float* left = planes[0];
+    const float* right = planes[1];
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        int16x4x2_t zipped = { {
+            vqmovn_s32(scaleToS16(vld1q_f32(left + i))),
+            vqmovn_s32(scaleToS16(vld1q_f32(right + i)))
+        } };
+        vst2_s16(dst + 2 * i, zipped);
+    }
+    const float* tail[2] = { left + i, right + i };
+    AudioScalar::interleaveFloatToS16(tail, 2, frames - i, dst + 2 * i);
+}
+
+static void floatToS16(const float* src, size_t count, int16_t* dst) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        int16x4_t first = vqmovn_s32(scaleToS16(vld1q_f32(src + i)));
+        int16x4_t second = vqmovn_s32(scaleToS16(vld1q_f32(src + i + 4)));
+        vst1q_s16(dst + i, vcombine_s16(first, second));
+    }
+    AudioScalar::floatToS16(src + i, count - i, dst + i);
+}
+
+static void mixChannels(const float* const* in_planes, int in_channels,
+    float* const* out_planes, int out_channels, size_t frames, const float* matrix) {
+    for (int o = 0; o < out_channels; ++o) {
+        const float* row = matrix + o * in_channels;
+        float* out = out_planes[o];
+        size_t i = 0;
+        for (; i + 4 <= frames; i += 4) {
+            float32x4_t sum = vdupq_n_f32(0.0f);
+            for (int c = 0; c < in_channels; ++c) {
+                sum = vmlaq_n_f32(sum, vld1q_f32(in_planes[c] + i), row[c]);
+            }
+            vst1q_f32(out + i, sum);
+        }
+        for (; i < frames; ++i) {
+            float sum = 0.0f;
+            for (int c = 0; c < in_channels; ++c) {
+                sum += row[c] * in_planes[c][i];
+            }
+            out[i] = sum;
+        }
+    }
+}
+
+void FillNeonKernels(AudioKernelTable& table) {
+    table.name = "neon";
+    table.interleaveFloat = interleaveFloat;
+    table.deinterleaveFloat = deinterleaveFloat;
+    table.interleaveFloatToS16 = interleaveFloatToS16;
+    table.floatToS16 = floatToS16;
+    table.mixChannels = mixChannels;
+}
+
+#endif // AUDIO_KERNELS_NEON
@@ -0,0 +1,217 @@
+#include "AudioKernelsImpl.h"
+
+#ifdef AUDIO_KERNELS_X86
+#include <emmintrin.h>
+
+// 32-bit GCC/Clang builds without -msse2 still get these, enabled per
+// function; dispatch only calls them after checking the CPU
+#if defined(__GNUC__) && !defined(__SSE2__)
+#define SSE2_TARGET __attribute__((target("sse2")))
+#else
+#define SSE2_TARGET
+#endif
+
+// NaN lanes to 0. max/min would otherwise turn them into the low clamp
+// and cvtps into 0x80000000, a full-scale click.
+SSE2_TARGET static inline __m128 zeroNaN(__m128 x) {
+    return _mm_and_ps(x, _mm_cmpord_ps(x, x));
+}
+
+// Four floats to four int32 on the S16 scale, clamped so the conversion
+// can't overflow before packs_epi32 saturates
+SSE2_TARGET static inline __m128i scaleToS16(__m128 samples) {
+    const __m128 lo = _mm_set1_ps(-32768.0f);
+    const __m128 hi = _mm_set1_ps(32767.0f);
+    return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(zeroNaN(_mm_mul_ps(samples, _mm_set1_ps(32768.0f))), lo), hi));
+}
+
+// Four xorshift32 generators side by side
+SSE2_TARGET static inline __m128i nextRandom(__m128i x) {
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+    return _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+}
+
+SSE2_TARGET static inline __m128 unitFromBits(__m128i bits) {
+    return _mm_castsi128_ps(_mm_or_si128(_mm_srli_epi32(bits, 9), _mm_set1_epi32(0x3f800000)));
+}
+
+SSE2_TARGET static void interleaveFloat(const float* const* planes, int channels, size_t frames, float* dst) {
+    if (channels != 2) {
+        AudioScalar::interleaveFloat(planes, channels, frames, dst);
+        return;
+    }
+    const float* left = planes[0];
+    const float* right = planes[1];
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        __m128 l = _mm_loadu_ps(left + i);
+        __m128 r = _mm_loadu_ps(right + i);
+        _mm_storeu_ps(dst + 2 * i, _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(dst + 2 * i + 4, _mm_unpackhi_ps(l, r));
+    }
+    const float* tail[2] = { left + i, right + i };
+    AudioScalar::interleaveFloat(tail, 2, frames - i, dst + 2 * i);
+}
+
+SSE2_TARGET static void deinterleaveFloat(const float* src, int channels, size_t frames, float* const* planes) {
+    if (channels != 2) {
+        AudioScalar::deinterleaveFloat(src, channels, frames, planes);
+        return;
+    }
+    float* left = planes[0];
+    float* right = planes[1];
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        __m128 a = _mm_loadu_ps(src + 2 * i);     // l0 r0 l1 r1
+        __m128 b = _mm_loadu_ps(src + 2 * i + 4); // l2 r2 l3 r3
+        _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+    float* tail[2] = { left + i, right + i };
+    AudioScalar::deinterleaveFloat(src + 2 * i, 2, frames - i, tail);
+}
+
+SSE2_TARGET static void interleaveFloatToS16(const float* const* planes, int channels, size_t frames, int16_t* dst) {
+    if (channels != 2) {
+        AudioScalar::interleaveFloatToS16(planes, channels, frames, dst);
+        return;
+    }
+    const float* left = planes[0];
+    const float* right = planes[1];
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        __m128 l = _mm_loadu_ps(left + i);
+        __m128 r = _mm_loadu_ps(right + i);
+        __m128i first = scaleToS16(_mm_unpacklo_ps(l, r));
+        __m128i second = scaleToS16(_mm_unpackhi_ps(l, r));
+        _mm_storeu_si128((__m128i*)(dst + 2 * i), _mm_packs_epi32(first, second));
+    }
+    const float* tail[2] = { left + i, right + i };
+    AudioScalar::interleaveFloatToS16(tail, 2, frames - i, dst + 2 * i);
+}
+
+SSE2_TARGET static void floatToS16(const float* src, size_t count, int16_t* dst) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i first = scaleToS16(_mm_loadu_ps(src + i));
+        __m128i second = scaleToS16(_mm_loadu_ps(src + i + 4));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(first, second));
+    }
+    AudioScalar::floatToS16(src + i, count - i, dst + i);
+}
+
+SSE2_TARGET static void floatToS32(const float* src, size_t count, int32_t* dst) {
+    const __m128 scale = _mm_set1_ps(2147483648.0f);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        // Out of range converts to 0x80000000, which is already right for
+        // the negative side; flipping its bits gives INT32_MAX for the other
+        __m128 scaled = zeroNaN(_mm_mul_ps(_mm_loadu_ps(src + i), scale));
+        __m128i overflow = _mm_castps_si128(_mm_cmpge_ps(scaled, scale));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(_mm_cvtps_epi32(scaled), overflow));
+    }
+    AudioScalar::floatToS32(src + i, count - i, dst + i);
+}
+
+SSE2_TARGET static void s32ToFloat(const int32_t* src, size_t count, float* dst) {
+    const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i samples = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(samples), scale));
+    }
+    AudioScalar::s32ToFloat(src + i, count - i, dst + i);
+}
+
+SSE2_TARGET static void floatToS16Dither(const float* src, size_t count, int16_t* dst, AudioDither& dither) {
+    __m128i a = _mm_loadu_si128((const __m128i*)dither.state);
+    __m128i b = _mm_loadu_si128((const __m128i*)(dither.state + 8));
+    const __m128 lo = _mm_set1_ps(-32768.0f);
+    const __m128 hi = _mm_set1_ps(32767.0f);
+    const __m128 scale = _mm_set1_ps(32768.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i packed[2];
+        for (int half = 0; half < 2; ++half) {
+            a = nextRandom(a);
+            b = nextRandom(b);
+            __m128 noise = _mm_sub_ps(unitFromBits(a), unitFromBits(b));
+            __m128 scaled = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + i + 4 * half), scale), noise);
+            packed[half] = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(zeroNaN(scaled), lo), hi));
+        }
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(packed[0], packed[1]));
+    }
+
+    _mm_storeu_si128((__m128i*)dither.state, a);
+    _mm_storeu_si128((__m128i*)(dither.state + 8), b);
+    AudioScalar::floatToS16Dither(src + i, count - i, dst + i, dither);
+}
+
+SSE2_TARGET static void applyGainRamp(float* samples, int channels, size_t frames, float gain_from, float gain_to) {
+    if ((channels != 1 && channels != 2) || frames == 0) {
+        AudioScalar::applyGainRamp(samples, channels, frames, gain_from, gain_to);
+        return;
+    }
+
+    // Four samples are four mono frames or two stereo ones; the gain is
+    // worked out from the frame index each time so it doesn't drift
+    float step = (gain_to - gain_from) / (float)frames;
+    const __m128 index = channels == 1 ? _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f) : _mm_setr_ps(0.0f, 0.0f, 1.0f, 1.0f);
+    const size_t frames_per_vector = 4 / channels;
+    const __m128 from = _mm_set1_ps(gain_from);
+    const __m128 step4 = _mm_set1_ps(step);
+
+    size_t i = 0;
+    for (; i + frames_per_vector <= frames; i += frames_per_vector) {
+        __m128 frame = _mm_add_ps(_mm_set1_ps((float)i), index);
+        __m128 gain = _mm_add_ps(from, _mm_mul_ps(step4, frame));
+        float* p = samples + i * channels;
+        _mm_storeu_ps(p, _mm_mul_ps(_mm_loadu_ps(p), gain));
+    }
+    for (; i < frames; ++i) {
+        float gain = gain_from + step * (float)i;
+        for (int c = 0; c < channels; ++c) {
+            samples[i * channels + c] *= gain;
+        }
+    }
+}
+
+SSE2_TARGET static void mixChannels(const float* const* in_planes, int in_channels,
+    float* const* out_planes, int out_channels, size_t frames, const float* matrix) {
+    for (int o = 0; o < out_channels; ++o) {
+        const float* row = matrix + o * in_channels;
+        float* out = out_planes[o];
+        size_t i = 0;
+        for (; i + 4 <= frames; i += 4) {
+            __m128 sum = _mm_setzero_ps();
+            for (int c = 0; c < in_channels; ++c) {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(row[c]), _mm_loadu_ps(in_planes[c] + i)));
+            }
+            _mm_storeu_ps(out + i, sum);
+        }
+        for (; i < frames; ++i) {
+            float sum = 0.0f;
+            for (int c = 0; c < in_channels; ++c) {
+                sum += row[c] * in_planes[c][i];
+            }
+            out[i] = sum;
+        }
+    }
+}
+
+void FillSse2Kernels(AudioKernelTable& table) {
+    table.name = "sse2";
+    table.interleaveFloat = interleaveFloat;
+    table.deinterleaveFloat = deinterleaveFloat;
+    table.interleaveFloatToS16 = interleaveFloatToS16;
+    table.floatToS16 = floatToS16;
+    table.floatToS32 = floatToS32;
+    table.s32ToFloat = s32ToFloat;
+    table.floatToS16Dither = floatToS16Dither;
+    table.applyGainRamp = applyGainRamp;
+    table.mixChannels = mixChannels;
+}
+
+#endif // AUDIO_KERNELS_X86
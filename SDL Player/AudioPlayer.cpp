@@ -0,0 +1,193 @@
+#include "AudioPlayer.h"
+#include <cstring>
+#include <iostream>
+
+AudioPlayer::AudioPlayer()
+    : stream(nullptr), ring(nullptr), spec(), underruns(0), silence_bytes(0),
+    paused(true), end_of_stream(false), output_bytes(0), output_silence(0), silence_runs(),
+    next_silence_run(0), position_seq(0), position_bytes(0), position_ns(0), latency_bytes(0) {
+    memset(silence, 0, sizeof(silence));
+}
+
+AudioPlayer::~AudioPlayer() {
+    close();
+}
+
+SDL_AudioSpec AudioPlayer::queryDeviceSpec() {
+    SDL_AudioSpec device = {};
+    int sample_frames = 0;
+    if (!SDL_GetAudioDeviceFormat(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &device, &sample_frames)
+        || device.freq <= 0 || device.channels <= 0) {
+        std::cerr << "Couldn't query audio device format, assuming 48000 Hz stereo: " << SDL_GetError() << "\n";
+        device.format = SDL_AUDIO_S16;
+        device.channels = 2;
+        device.freq = 48000;
+    }
+    return device;
+}
+
+bool AudioPlayer::open(const SDL_AudioSpec& desired, AudioRingBuffer* source) {
+    close();
+
+    ring = source;
+    spec = desired;
+    stream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec, streamCallback, this);
+    if (!stream) {
+        std::cerr << "Failed to open audio device: " << SDL_GetError() << "\n";
+        return false;
+    }
+
+    // One device buffer is always between the stream and the speaker
+    SDL_AudioSpec device = {};
+    int buffer_frames = 0;
+    latency_bytes = 0;
+    if (SDL_GetAudioDeviceFormat(SDL_GetAudioStreamDevice(stream), &device, &buffer_frames) && device.freq > 0) {
+        latency_bytes = (uint64_t)buffer_frames * spec.freq / device.freq * SDL_AUDIO_FRAMESIZE(spec);
+    }
+    return true;
+}
+
+void AudioPlayer::close() {
+    if (stream) {
+        // Also closes the device and waits out a running callback
+        SDL_DestroyAudioStream(stream);
+        stream = nullptr;
+    }
+}
+
+void AudioPlayer::pause() {
+    paused.store(true, std::memory_order_relaxed);
+    if (stream) {
+        SDL_PauseAudioStreamDevice(stream);
+    }
+}
+
+void AudioPlayer::resume() {
+    if (stream) {
+        SDL_ResumeAudioStreamDevice(stream);
+    }
+    paused.store(false, std::memory_order_relaxed);
+}
+
+void AudioPlayer::setEndOfStream() {
+    end_of_stream.store(true, std::memory_order_release);
+}
+
+void SDLCALL AudioPlayer::streamCallback(void* userdata, SDL_AudioStream* stream, int additional_amount, int total_amount) {
+    (void)total_amount;
+    if (additional_amount > 0) {
+        static_cast<AudioPlayer*>(userdata)->feed(stream, additional_amount);
+    }
+}
+
+void AudioPlayer::feed(SDL_AudioStream* target, int bytes) {
+    // Straight from ring memory; at most two spans either side of the wrap
+    int remaining = bytes;
+    while (remaining > 0) {
+        size_t contiguous = 0;
+        const uint8_t* data = ring->peekRead(contiguous);
+        if (contiguous == 0) {
+            break;
+        }
+        int chunk = contiguous < (size_t)remaining ? (int)contiguous : remaining;
+        SDL_PutAudioStreamData(target, data, chunk);
+        ring->commitRead(chunk);
+        remaining -= chunk;
+    }
+
+    int from_ring = bytes - remaining;
+    if (from_ring > 0) {
+        output_bytes += (uint64_t)from_ring;
+        publishPosition(target); // before any silence is queued behind it
+    }
+
+    if (remaining > 0) {
+        // Running dry at the end, or a callback racing a pause, is expected
+        if (!end_of_stream.load(std::memory_order_acquire) && !paused.load(std::memory_order_relaxed)) {
+            underruns.fetch_add(1, std::memory_order_relaxed);
+            silence_bytes.fetch_add(remaining, std::memory_order_relaxed);
+        }
+        addSilence(target, remaining);
+    }
+}
+
+void AudioPlayer::addSilence(SDL_AudioStream* target, int bytes) {
+    SilenceRun& run = silence_runs[next_silence_run];
+    run.start = output_bytes;
+    run.bytes = (uint64_t)bytes;
+    next_silence_run = (next_silence_run + 1) % kSilenceRuns;
+    output_bytes += (uint64_t)bytes;
+    output_silence += (uint64_t)bytes;
+
+    while (bytes > 0) {
+        int chunk = bytes < kSilenceSize ? bytes : kSilenceSize;
+        SDL_PutAudioStreamData(target, silence, chunk);
+        bytes -= chunk;
+    }
+}
+
+void AudioPlayer::publishPosition(SDL_AudioStream* target) {
+    // Output position at the speaker, then the silence up to there taken out
+    uint64_t pending = (uint64_t)SDL_GetAudioStreamQueued(target) + latency_bytes;
+    uint64_t heard_output = output_bytes > pending ? output_bytes - pending : 0;
+
+    uint64_t unheard_silence = 0;
+    for (int i = 0; i < kSilenceRuns; ++i) {
+        const SilenceRun& run = silence_runs[i];
+        uint64_t end = run.start + run.bytes;
+        if (end > heard_output) {
+            uint64_t ahead = end - heard_output;
+            unheard_silence += ahead < run.bytes ? ahead : run.bytes;
+        }
+    }
+    uint64_t heard_silence = output_silence - unheard_silence;
+    uint64_t heard = heard_output > heard_silence ? heard_output - heard_silence : 0;
+
+    uint32_t seq = position_seq.load(std::memory_order_relaxed);
+    position_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    position_bytes.store(heard, std::memory_order_relaxed);
+    position_ns.store(SDL_GetTicksNS(), std::memory_order_relaxed);
+    position_seq.store(seq + 2, std::memory_order_release);
+}
+
+bool AudioPlayer::getPlaybackPosition(uint64_t& bytes, Uint64& at_ns) const {
+    while (true) {
+        uint32_t seq = position_seq.load(std::memory_order_acquire);
+        if (seq & 1) {
+            continue; // callback is mid-update
+        }
+        uint64_t snapshot_bytes = position_bytes.load(std::memory_order_relaxed);
+        Uint64 snapshot_ns = position_ns.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (position_seq.load(std::memory_order_relaxed) == seq) {
+            if (snapshot_ns == 0) {
+                return false;
+            }
+            bytes = snapshot_bytes;
+            at_ns = snapshot_ns;
+            return true;
+        }
+    }
+}
+
+double AudioPlayer::getDeviceLatencyMs() const {
+    int frame_size = SDL_AUDIO_FRAMESIZE(spec);
+    return frame_size > 0 && spec.freq > 0 ? latency_bytes * 1000.0 / ((double)frame_size * spec.freq) : 0.0;
+}
+
+const SDL_AudioSpec& AudioPlayer::getSpec() const {
+    return spec;
+}
+
+int AudioPlayer::getQueuedBytes() const {
+    return stream ? SDL_GetAudioStreamQueued(stream) : 0;
+}
+
+uint64_t AudioPlayer::getUnderruns() const {
+    return underruns.load(std::memory_order_relaxed);
+}
+
+uint64_t AudioPlayer::getSilenceBytes() const {
+    return silence_bytes.load(std::memory_order_relaxed);
+}
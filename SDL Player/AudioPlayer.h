@@ -0,0 +1,94 @@
+#ifndef AUDIO_PLAYER_H
+#define AUDIO_PLAYER_H
+
+#include <SDL3/SDL.h>
+#include <atomic>
+#include <cstdint>
+
+#include "AudioRingBuffer.h"
+
+/// Pull-model audio output. SDL asks for data from its audio thread through
+/// an SDL_AudioStream get-callback, and the callback hands over exactly the
+/// requested amount straight out of the decoder's ring. That path takes no
+/// locks and allocates nothing; a short ring is padded with silence and,
+/// unless the stream has ended or is paused, counted as an underrun.
+class AudioPlayer {
+public:
+    AudioPlayer();
+    ~AudioPlayer();
+
+    AudioPlayer(const AudioPlayer&) = delete;
+    AudioPlayer& operator=(const AudioPlayer&) = delete;
+
+    /// The default playback device's native spec. Producing exactly this
+    /// means SDL's stream passes the data through without converting.
+    /// Falls back to 48000 Hz stereo S16 if the device can't be queried.
+    static SDL_AudioSpec queryDeviceSpec();
+
+    /// Opens the default playback device for 'spec' (the ring's format).
+    /// Starts paused; call resume() once there is something to play.
+    bool open(const SDL_AudioSpec& spec, AudioRingBuffer* ring);
+    void close();
+
+    void pause();
+    void resume();
+
+    /// The decoder has delivered everything; from here a short ring is the
+    /// stream running out, not an underrun. Call from the producer side.
+    void setEndOfStream();
+
+    const SDL_AudioSpec& getSpec() const;
+    int getQueuedBytes() const;        // handed to SDL but not yet to the device
+    uint64_t getUnderruns() const;     // callbacks the ring couldn't satisfy mid-stream
+    uint64_t getSilenceBytes() const;  // zeros inserted to cover them
+
+    /// How many ring bytes had reached the speaker at 'at_ns' (SDL ticks),
+    /// as of the last callback that played real data: everything handed to
+    /// SDL, less what is still queued in the stream and the device buffer,
+    /// less the padding silence already played. False until the first such
+    /// callback.
+    bool getPlaybackPosition(uint64_t& bytes, Uint64& at_ns) const;
+    double getDeviceLatencyMs() const; // the device buffer, from its reported size
+
+private:
+    static void SDLCALL streamCallback(void* userdata, SDL_AudioStream* stream, int additional_amount, int total_amount);
+    void feed(SDL_AudioStream* stream, int bytes);
+    void publishPosition(SDL_AudioStream* stream);
+    void addSilence(SDL_AudioStream* stream, int bytes);
+
+    SDL_AudioStream* stream;
+    AudioRingBuffer* ring;
+    SDL_AudioSpec spec;
+
+    std::atomic<uint64_t> underruns;
+    std::atomic<uint64_t> silence_bytes;
+    std::atomic<bool> paused;
+    std::atomic<bool> end_of_stream;
+
+    // Where padding went in the output, so the silence still queued or in
+    // the device buffer isn't taken for ring data. Only the last few runs
+    // can still be ahead of the speaker; older ones count as played.
+    struct SilenceRun {
+        uint64_t start; // output byte offset
+        uint64_t bytes;
+    };
+    static const int kSilenceRuns = 8;
+
+    // Written by the callback only. The position snapshot is two values, so
+    // it's published under a sequence count the reader retries on (odd
+    // while a write is in progress) instead of a lock
+    uint64_t output_bytes; // everything handed to SDL, silence included
+    uint64_t output_silence;
+    SilenceRun silence_runs[kSilenceRuns];
+    int next_silence_run;
+    std::atomic<uint32_t> position_seq;
+    std::atomic<uint64_t> position_bytes;
+    std::atomic<Uint64> position_ns;
+    uint64_t latency_bytes;
+
+    // Zero is silence for every signed and float format we output
+    static const int kSilenceSize = 4096;
+    uint8_t silence[kSilenceSize];
+};
+
+#endif // AUDIO_PLAYER_H
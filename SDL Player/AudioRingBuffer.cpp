@@ -0,0 +1,102 @@
+#include "AudioRingBuffer.h"
+#include <algorithm>
+#include <cstring>
+
+AudioRingBuffer::AudioRingBuffer(size_t capacity)
+    : data(new uint8_t[capacity > 0 ? capacity : 1]),
+    buffer_capacity(capacity > 0 ? capacity : 1),
+    write_pos(0), read_pos(0), cached_write_pos(0) {
+}
+
+size_t AudioRingBuffer::writeAvailable() const {
+    return buffer_capacity - (write_pos.load(std::memory_order_relaxed) - read_pos.load(std::memory_order_acquire));
+}
+
+uint8_t* AudioRingBuffer::acquireWrite(size_t& contiguous) {
+    size_t write = write_pos.load(std::memory_order_relaxed);
+    size_t free_bytes = buffer_capacity - (write - read_pos.load(std::memory_order_acquire));
+
+    size_t offset = write % buffer_capacity;
+    contiguous = std::min(free_bytes, buffer_capacity - offset);
+    return data.get() + offset;
+}
+
+void AudioRingBuffer::commitWrite(size_t bytes) {
+    write_pos.store(write_pos.load(std::memory_order_relaxed) + bytes, std::memory_order_release);
+}
+
+size_t AudioRingBuffer::write(const uint8_t* src, size_t bytes) {
+    size_t written = 0;
+    // At most two spans: up to the end of the buffer, then from the start
+    for (int span = 0; span < 2 && written < bytes; ++span) {
+        size_t contiguous;
+        uint8_t* dst = acquireWrite(contiguous);
+        size_t chunk = std::min(contiguous, bytes - written);
+        if (chunk == 0) {
+            break;
+        }
+        memcpy(dst, src + written, chunk);
+        commitWrite(chunk);
+        written += chunk;
+    }
+    return written;
+}
+
+size_t AudioRingBuffer::read(uint8_t* dst, size_t bytes) {
+    size_t read = read_pos.load(std::memory_order_relaxed);
+    size_t available = cached_write_pos - read;
+    if (available < bytes) {
+        cached_write_pos = write_pos.load(std::memory_order_acquire);
+        available = cached_write_pos - read;
+    }
+
+    size_t count = std::min(bytes, available);
+    size_t offset = read % buffer_capacity;
+    size_t first = std::min(count, buffer_capacity - offset);
+    memcpy(dst, data.get() + offset, first);
+    memcpy(dst + first, data.get(), count - first);
+
+    read_pos.store(read + count, std::memory_order_release);
+    return count;
+}
+
+const uint8_t* AudioRingBuffer::peekRead(size_t& contiguous) {
+    size_t read = read_pos.load(std::memory_order_relaxed);
+    size_t offset = read % buffer_capacity;
+    size_t available = cached_write_pos - read;
+    if (available < buffer_capacity - offset) {
+        cached_write_pos = write_pos.load(std::memory_order_acquire);
+        available = cached_write_pos - read;
+    }
+
+    contiguous = std::min(available, buffer_capacity - offset);
+    return data.get() + offset;
+}
+
+void AudioRingBuffer::commitRead(size_t bytes) {
+    read_pos.store(read_pos.load(std::memory_order_relaxed) + bytes, std::memory_order_release);
+}
+
+size_t AudioRingBuffer::readAvailable() const {
+    return write_pos.load(std::memory_order_acquire) - read_pos.load(std::memory_order_relaxed);
+}
+
+size_t AudioRingBuffer::size() const {
+    size_t read = read_pos.load(std::memory_order_acquire);
+    size_t write = write_pos.load(std::memory_order_acquire);
+    return write >= read ? write - read : 0;
+}
+
+size_t AudioRingBuffer::capacity() const {
+    return buffer_capacity;
+}
+
+double AudioRingBuffer::fillLevel() const {
+    return (double)size() / buffer_capacity;
+}
+
+void AudioRingBuffer::reset() {
+    write_pos.store(0, std::memory_order_relaxed);
+    read_pos.store(0, std::memory_order_relaxed);
+    cached_write_pos = 0;
+}
@@ -0,0 +1,57 @@
+#ifndef AUDIO_RING_BUFFER_H
+#define AUDIO_RING_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/// Fixed-capacity single-producer/single-consumer byte ring for decoded audio.
+/// One thread writes (the decoder), one thread reads (the audio device
+/// callback); neither ever locks or allocates, and a read is wait-free.
+/// Pick a capacity that is a whole number of sample frames so a frame never
+/// straddles the wrap point in acquireWrite().
+class AudioRingBuffer {
+public:
+    explicit AudioRingBuffer(size_t capacity);
+
+    AudioRingBuffer(const AudioRingBuffer&) = delete;
+    AudioRingBuffer& operator=(const AudioRingBuffer&) = delete;
+
+    // Producer side
+    size_t write(const uint8_t* data, size_t bytes); // returns bytes actually written
+    uint8_t* acquireWrite(size_t& contiguous);       // free space up to the wrap point
+    void commitWrite(size_t bytes);                  // publishes bytes filled via acquireWrite()
+    size_t writeAvailable() const;
+
+    // Consumer side
+    size_t read(uint8_t* dst, size_t bytes);         // returns bytes actually read
+    const uint8_t* peekRead(size_t& contiguous);     // readable data up to the wrap point
+    void commitRead(size_t bytes);                   // releases bytes consumed via peekRead()
+    size_t readAvailable() const;
+
+    // Either side; approximate while the other side is running
+    size_t size() const;
+    size_t capacity() const;
+    double fillLevel() const; // 0..1
+
+    /// Empties the ring. Only safe while neither side is running.
+    void reset();
+
+private:
+    static const size_t kCacheLine = 64;
+
+    std::unique_ptr<uint8_t[]> data;
+    size_t buffer_capacity;
+
+    // Monotonic byte counters; index = counter % capacity. Each lives on
+    // its own cache line so the two threads don't false-share. The reader
+    // keeps a stale copy of write_pos and only re-reads the shared one when
+    // that copy runs dry, so the callback rarely touches the producer's line.
+    alignas(kCacheLine) std::atomic<size_t> write_pos;
+    alignas(kCacheLine) std::atomic<size_t> read_pos;
+    size_t cached_write_pos;
+    char padding[kCacheLine - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+};
+
+#endif // AUDIO_RING_BUFFER_H
@@ -1,17 +1,25 @@
 #include "AudioUtils.h"
-extern "C" {
-#include <libavutil/channel_layout.h>
-}
 
-uint64_t GetDefaultChannelLayout(int channels) {
+// SDL's 5-channel layout (quad plus LFE) has no FFmpeg name
+static const uint64_t kLayoutQuadLfe = AV_CH_LAYOUT_QUAD | AV_CH_LOW_FREQUENCY;
+
+void GetDefaultChannelLayout(int channels, AVChannelLayout* layout) {
+    // Native masks list channels in bit order, which is SDL's order for
+    // all of these
+    uint64_t mask = 0;
     switch (channels) {
-    case 1: return AV_CH_LAYOUT_MONO;
-    case 2: return AV_CH_LAYOUT_STEREO;
-    case 3: return AV_CH_LAYOUT_2_1;
-    case 4: return AV_CH_LAYOUT_QUAD;
-    case 5: return AV_CH_LAYOUT_5POINT0_BACK;
-    case 6: return AV_CH_LAYOUT_5POINT1_BACK;
-        // Add more as needed
-    default: return AV_CH_LAYOUT_STEREO;
+    case 1: mask = AV_CH_LAYOUT_MONO; break;
+    case 2: mask = AV_CH_LAYOUT_STEREO; break;
+    case 3: mask = AV_CH_LAYOUT_2POINT1; break;       // FL FR LFE
+    case 4: mask = AV_CH_LAYOUT_QUAD; break;          // FL FR BL BR
+    case 5: mask = kLayoutQuadLfe; break;             // FL FR LFE BL BR
+    case 6: mask = AV_CH_LAYOUT_5POINT1_BACK; break;  // FL FR FC LFE BL BR
+    case 7: mask = AV_CH_LAYOUT_6POINT1; break;       // FL FR FC LFE BC SL SR
+    case 8: mask = AV_CH_LAYOUT_7POINT1; break;       // FL FR FC LFE BL BR SL SR
+    default: break;
+    }
+
+    if (mask == 0 || av_channel_layout_from_mask(layout, mask) < 0) {
+        av_channel_layout_default(layout, channels > 0 ? channels : 2);
     }
 }
@@ -2,10 +2,14 @@
 #ifndef AUDIO_UTILS_H
 #define AUDIO_UTILS_H
 
-#include <cstdint>
+extern "C" {
+#include <libavutil/channel_layout.h>
+}
 
-/// Returns a default channel layout mask for the given number of channels.
-/// Returns 0 if unknown or unsupported.
-uint64_t GetDefaultChannelLayout(int channels);
+/// Fills 'layout' with the channel layout an SDL audio device uses for the
+/// given number of channels, so interleaved output lands on the right
+/// speakers: SDL's own orders from mono up to 7.1. Any other count gets
+/// FFmpeg's default layout for it. Uninitialise 'layout' when done.
+void GetDefaultChannelLayout(int channels, AVChannelLayout* layout);
 
 #endif // AUDIO_UTILS_H
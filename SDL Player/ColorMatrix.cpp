@@ -0,0 +1,25 @@
+#include "ColorMatrix.h"
+
+ColorStandard colorStandardFor(AVColorSpace colorspace, int height) {
+	switch (colorspace) {
+	case AVCOL_SPC_BT709:
+	case AVCOL_SPC_SMPTE240M: // close enough to 709 for display
+		return COLOR_BT709;
+	case AVCOL_SPC_BT470BG:
+	case AVCOL_SPC_SMPTE170M:
+	case AVCOL_SPC_FCC:
+		return COLOR_BT601;
+	case AVCOL_SPC_BT2020_NCL:
+	case AVCOL_SPC_BT2020_CL:
+		return COLOR_BT2020;
+	default:
+		// Untagged content: HD and up is almost always 709
+		return height >= 720 ? COLOR_BT709 : COLOR_BT601;
+	}
+}
+
+const ColorMatrix& colorMatrixFor(AVColorSpace colorspace, AVColorRange range, int height) {
+	// Untagged range is treated as limited, which is what nearly all video uses
+	int full = (range == AVCOL_RANGE_JPEG) ? 1 : 0;
+	return kColorMatrices[colorStandardFor(colorspace, height)][full];
+}
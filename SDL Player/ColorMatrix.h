@@ -0,0 +1,109 @@
+#pragma once
+#include <cstdint>
+
+extern "C" {
+#include <libavutil/pixfmt.h>
+}
+
+// YCbCr -> RGB coefficient tables for BT.601, BT.709 and BT.2020 in both
+// limited (studio) and full range, all computed at compile time from the
+// standards' Kr/Kb constants, in swscale's inverse-table format.
+struct ColorMatrix {
+	int sws[4];      // crv, cbu, cgu, cgv in 16.16 as sws_setColorspaceDetails() wants
+	bool full_range; // passed as srcRange
+};
+
+enum ColorStandard {
+	COLOR_BT601,
+	COLOR_BT709,
+	COLOR_BT2020,
+	COLOR_STANDARD_COUNT
+};
+
+constexpr ColorMatrix makeColorMatrix(double kr, double kb, bool full_range) {
+	ColorMatrix c{};
+	const double kg = 1.0 - kr - kb;
+
+	const double crv = 2.0 * (1.0 - kr);
+	const double cbu = 2.0 * (1.0 - kb);
+	const double cgu = 2.0 * kb * (1.0 - kb) / kg;
+	const double cgv = 2.0 * kr * (1.0 - kr) / kg;
+
+	// swscale always takes the studio-swing chroma scale and applies the
+	// range itself from the srcRange flag
+	const double sws_unit = 255.0 / 224.0 * 65536.0;
+	c.sws[0] = (int)(crv * sws_unit + 0.5);
+	c.sws[1] = (int)(cbu * sws_unit + 0.5);
+	c.sws[2] = (int)(cgu * sws_unit + 0.5);
+	c.sws[3] = (int)(cgv * sws_unit + 0.5);
+
+	c.full_range = full_range;
+	return c;
+}
+
+// [standard][0 = limited, 1 = full]
+constexpr ColorMatrix kColorMatrices[COLOR_STANDARD_COUNT][2] = {
+	{ makeColorMatrix(0.299,  0.114,  false), makeColorMatrix(0.299,  0.114,  true) },
+	{ makeColorMatrix(0.2126, 0.0722, false), makeColorMatrix(0.2126, 0.0722, true) },
+	{ makeColorMatrix(0.2627, 0.0593, false), makeColorMatrix(0.2627, 0.0593, true) },
+};
+
+// Picks the table for a frame's colour metadata. Unspecified matrices are
+// guessed from the frame height the way broadcast players do (SD = 601).
+ColorStandard colorStandardFor(AVColorSpace colorspace, int height);
+const ColorMatrix& colorMatrixFor(AVColorSpace colorspace, AVColorRange range, int height);
+
+// Reference test patterns, checked by the compiler. The model follows
+// ff_yuv2rgb_c_init_tables() with neutral brightness/contrast/saturation:
+// limited range stretches Y by 255/219 around 16, full range scales the
+// chroma terms down by 224/255. Results are 8-bit RGB.
+namespace color_check {
+	constexpr double chroma(const ColorMatrix& c, int i) {
+		return (c.full_range ? (int64_t)c.sws[i] * 224 / 255 : (int64_t)c.sws[i]) / 65536.0;
+	}
+
+	constexpr double luma(const ColorMatrix& c, int y) {
+		return c.full_range ? (double)y : (y - 16) * 255.0 / 219.0;
+	}
+
+	constexpr bool within(double value, double expected) {
+		// within 1.5 code values
+		return value - expected < 1.5 && expected - value < 1.5;
+	}
+
+	constexpr bool rgb(const ColorMatrix& c, int y, int cb, int cr, int r, int g, int b) {
+		return within(luma(c, y) + chroma(c, 0) * (cr - 128), r) &&
+			within(luma(c, y) - chroma(c, 2) * (cb - 128) - chroma(c, 3) * (cr - 128), g) &&
+			within(luma(c, y) + chroma(c, 1) * (cb - 128), b);
+	}
+
+	// 100% bars plus black and white, 8-bit code values for one table
+	constexpr bool bars(const ColorMatrix& c, const int (&codes)[5][3]) {
+		return rgb(c, codes[0][0], codes[0][1], codes[0][2], 0, 0, 0) &&
+			rgb(c, codes[1][0], codes[1][1], codes[1][2], 255, 255, 255) &&
+			rgb(c, codes[2][0], codes[2][1], codes[2][2], 255, 0, 0) &&
+			rgb(c, codes[3][0], codes[3][1], codes[3][2], 0, 255, 0) &&
+			rgb(c, codes[4][0], codes[4][1], codes[4][2], 0, 0, 255);
+	}
+
+	// black, white, red, green, blue
+	constexpr int kBars601Limited[5][3]  = { { 16, 128, 128 }, { 235, 128, 128 }, { 81, 90, 240 },  { 145, 54, 34 },  { 41, 240, 110 } };
+	constexpr int kBars601Full[5][3]     = { { 0, 128, 128 },  { 255, 128, 128 }, { 76, 85, 255 },  { 150, 44, 21 },  { 29, 255, 107 } };
+	constexpr int kBars709Limited[5][3]  = { { 16, 128, 128 }, { 235, 128, 128 }, { 63, 102, 240 }, { 173, 42, 26 },  { 32, 240, 118 } };
+	constexpr int kBars709Full[5][3]     = { { 0, 128, 128 },  { 255, 128, 128 }, { 54, 99, 255 },  { 182, 30, 12 },  { 18, 255, 116 } };
+	constexpr int kBars2020Limited[5][3] = { { 16, 128, 128 }, { 235, 128, 128 }, { 74, 97, 240 },  { 164, 47, 25 },  { 29, 240, 119 } };
+	constexpr int kBars2020Full[5][3]    = { { 0, 128, 128 },  { 255, 128, 128 }, { 67, 92, 255 },  { 173, 36, 11 },  { 15, 255, 118 } };
+}
+
+static_assert(color_check::bars(kColorMatrices[COLOR_BT601][0], color_check::kBars601Limited), "BT.601 limited bars");
+static_assert(color_check::bars(kColorMatrices[COLOR_BT601][1], color_check::kBars601Full), "BT.601 full bars");
+static_assert(color_check::bars(kColorMatrices[COLOR_BT709][0], color_check::kBars709Limited), "BT.709 limited bars");
+static_assert(color_check::bars(kColorMatrices[COLOR_BT709][1], color_check::kBars709Full), "BT.709 full bars");
+static_assert(color_check::bars(kColorMatrices[COLOR_BT2020][0], color_check::kBars2020Limited), "BT.2020 limited bars");
+static_assert(color_check::bars(kColorMatrices[COLOR_BT2020][1], color_check::kBars2020Full), "BT.2020 full bars");
+
+// The swscale form must match libswscale's own BT.601/709 tables
+static_assert(kColorMatrices[COLOR_BT601][0].sws[0] == 104597 && kColorMatrices[COLOR_BT601][0].sws[1] == 132201 &&
+	kColorMatrices[COLOR_BT601][0].sws[2] == 25675 && kColorMatrices[COLOR_BT601][0].sws[3] == 53279, "BT.601 swscale table");
+static_assert(kColorMatrices[COLOR_BT709][0].sws[0] == 117489 && kColorMatrices[COLOR_BT709][0].sws[1] == 138438 &&
+	kColorMatrices[COLOR_BT709][0].sws[2] == 13975 && kColorMatrices[COLOR_BT709][0].sws[3] == 34925, "BT.709 swscale table");
@@ -0,0 +1,204 @@
+#include "Deinterlacer.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+extern "C" {
+#include <libavutil/mem.h>
+#include <libavutil/pixdesc.h>
+}
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedMs(Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+Deinterlacer::Deinterlacer() {}
+
+Deinterlacer::~Deinterlacer() {
+	if (frames_out > 0) {
+		double avg = getAverageMs();
+		std::cout << "Deinterlace: " << frames_out << " frames, "
+			<< avg << " ms/frame (" << (avg > 0.0 ? 1000.0 / avg : 0.0) << " fps max)\n";
+	}
+	freeDrainGraph();
+	freeGraph();
+}
+
+bool Deinterlacer::init(const AVFrame* frame, AVRational time_base) {
+	freeGraph();
+
+	// bwdif is the better filter, yadif is the fallback for minimal builds
+	const char* filter_desc = "bwdif=mode=send_frame:parity=auto:deint=interlaced";
+	if (!avfilter_get_by_name("bwdif")) {
+		filter_desc = "yadif=mode=send_frame:parity=auto:deint=interlaced";
+	}
+
+	graph = avfilter_graph_alloc();
+	if (!graph) {
+		std::cerr << "Failed to allocate filter graph\n";
+		return false;
+	}
+
+	// Both filters support slice threading; let them use every core
+	graph->thread_type = AVFILTER_THREAD_SLICE;
+	graph->nb_threads = (int)std::thread::hardware_concurrency();
+
+	AVRational sar = frame->sample_aspect_ratio;
+	if (sar.num == 0 || sar.den == 0) {
+		sar = AVRational{ 1, 1 };
+	}
+
+	char args[256];
+	snprintf(args, sizeof(args),
+		"video_size=%dx%d:pix_fmt=%d:time_base=%d/%d:pixel_aspect=%d/%d",
+		frame->width, frame->height, frame->format,
+		time_base.num, time_base.den, sar.num, sar.den);
+
+	if (avfilter_graph_create_filter(&src_ctx, avfilter_get_by_name("buffer"),
+		"in", args, nullptr, graph) < 0) {
+		std::cerr << "Failed to create filter source\n";
+		freeGraph();
+		return false;
+	}
+
+	if (avfilter_graph_create_filter(&sink_ctx, avfilter_get_by_name("buffersink"),
+		"out", nullptr, nullptr, graph) < 0) {
+		std::cerr << "Failed to create filter sink\n";
+		freeGraph();
+		return false;
+	}
+
+	AVFilterInOut* outputs = avfilter_inout_alloc();
+	AVFilterInOut* inputs = avfilter_inout_alloc();
+	if (!outputs || !inputs) {
+		avfilter_inout_free(&outputs);
+		avfilter_inout_free(&inputs);
+		freeGraph();
+		return false;
+	}
+
+	outputs->name = av_strdup("in");
+	outputs->filter_ctx = src_ctx;
+	outputs->pad_idx = 0;
+	outputs->next = nullptr;
+
+	inputs->name = av_strdup("out");
+	inputs->filter_ctx = sink_ctx;
+	inputs->pad_idx = 0;
+	inputs->next = nullptr;
+
+	int ret = avfilter_graph_parse_ptr(graph, filter_desc, &inputs, &outputs, nullptr);
+	avfilter_inout_free(&inputs);
+	avfilter_inout_free(&outputs);
+	if (ret < 0 || avfilter_graph_config(graph, nullptr) < 0) {
+		std::cerr << "Failed to configure deinterlace filter: " << filter_desc << "\n";
+		freeGraph();
+		return false;
+	}
+
+	width = frame->width;
+	height = frame->height;
+	format = frame->format;
+
+	std::cout << "Deinterlacing " << width << "x" << height << " "
+		<< av_get_pix_fmt_name((AVPixelFormat)format) << " with "
+		<< filter_desc << " (" << graph->nb_threads << " threads)\n";
+	return true;
+}
+
+void Deinterlacer::freeGraph() {
+	avfilter_graph_free(&graph);
+	src_ctx = nullptr;
+	sink_ctx = nullptr;
+	width = height = 0;
+	format = -1;
+}
+
+void Deinterlacer::freeDrainGraph() {
+	avfilter_graph_free(&drain_graph);
+	drain_sink_ctx = nullptr;
+}
+
+void Deinterlacer::retire() {
+	if (!graph) {
+		return;
+	}
+	// Two changes before the first drained is too rare to queue for
+	freeDrainGraph();
+
+	// Same as the end-of-stream flush: EOF makes the filter give up the
+	// frame it holds back, which pull() then hands out before anything new
+	av_buffersrc_add_frame_flags(src_ctx, nullptr, 0);
+	drain_graph = graph;
+	drain_sink_ctx = sink_ctx;
+	graph = nullptr;
+	freeGraph();
+}
+
+bool Deinterlacer::push(AVFrame* frame, AVRational time_base) {
+	if (!graph || frame->width != width || frame->height != height || frame->format != format) {
+		retire();
+		if (!init(frame, time_base)) {
+			return false;
+		}
+	}
+
+	Clock::time_point start = Clock::now();
+	int ret = av_buffersrc_add_frame_flags(src_ctx, frame, AV_BUFFERSRC_FLAG_KEEP_REF);
+	total_ms += elapsedMs(start);
+
+	if (ret < 0) {
+		std::cerr << "Error feeding the deinterlace filter\n";
+		return false;
+	}
+	return true;
+}
+
+int Deinterlacer::pull(AVFrame* out) {
+	av_frame_unref(out);
+
+	// Whatever the old geometry's graph still holds goes out first
+	if (drain_graph) {
+		Clock::time_point start = Clock::now();
+		int ret = av_buffersink_get_frame(drain_sink_ctx, out);
+		total_ms += elapsedMs(start);
+		if (ret == 0) {
+			++frames_out;
+			return 0;
+		}
+		freeDrainGraph(); // EOF, or nothing more to get out of it
+		if (!graph) {
+			return AVERROR(EAGAIN); // the rebuild failed, the caller goes on without us
+		}
+	}
+
+	if (!graph) {
+		return AVERROR_EOF;
+	}
+
+	Clock::time_point start = Clock::now();
+	int ret = av_buffersink_get_frame(sink_ctx, out);
+	total_ms += elapsedMs(start);
+
+	if (ret == 0) {
+		++frames_out;
+	}
+	return ret;
+}
+
+void Deinterlacer::flush() {
+	if (graph) {
+		av_buffersrc_add_frame_flags(src_ctx, nullptr, 0);
+	}
+}
+
+bool Deinterlacer::isActive() const {
+	return graph != nullptr || drain_graph != nullptr;
+}
+
+double Deinterlacer::getAverageMs() const {
+	return frames_out ? total_ms / frames_out : 0.0;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavfilter/avfilter.h>
+#include <libavfilter/buffersink.h>
+#include <libavfilter/buffersrc.h>
+}
+
+#include <cstdint>
+
+// Optional libavfilter stage between decode and conversion.
+// Runs bwdif (or yadif if the build lacks it) with slice threading.
+// Built lazily for the first interlaced frame and rebuilt whenever the
+// input geometry changes; progressive frames pass through untouched. On a
+// rebuild the old graph is flushed and drained through pull() first, so
+// the frame bwdif holds back isn't lost.
+class Deinterlacer {
+public:
+	Deinterlacer();
+	~Deinterlacer();
+
+	Deinterlacer(const Deinterlacer&) = delete;
+	Deinterlacer& operator=(const Deinterlacer&) = delete;
+
+	bool push(AVFrame* frame, AVRational time_base); // keeps the caller's reference
+	int pull(AVFrame* out); // 0, AVERROR(EAGAIN) for more input, or AVERROR_EOF
+	void flush();           // signals end of stream so the last frame drains
+
+	bool isActive() const;
+	double getAverageMs() const; // filter cost per output frame, over the whole stream
+
+private:
+	bool init(const AVFrame* frame, AVRational time_base);
+	void retire(); // current graph -> draining graph
+	void freeGraph();
+	void freeDrainGraph();
+
+	AVFilterGraph* graph = nullptr;
+	AVFilterContext* src_ctx = nullptr;
+	AVFilterContext* sink_ctx = nullptr;
+
+	// previous geometry's graph, flushed and still handing out its last frames
+	AVFilterGraph* drain_graph = nullptr;
+	AVFilterContext* drain_sink_ctx = nullptr;
+
+	int width = 0;
+	int height = 0;
+	int format = -1;
+
+	// throughput measurement
+	uint64_t frames_out = 0;
+	double total_ms = 0.0;
+};
@@ -0,0 +1,38 @@
+#include "DriftController.h"
+
+DriftController::DriftController(double correction_seconds, double max_ppm)
+    : correction_seconds(correction_seconds > 0.0 ? correction_seconds : 1.0),
+    max_ppm(max_ppm), has_drift(false), last_ns(0), drift_ms(0.0), rate_ppm(0.0), corrected_ms(0.0) {
+}
+
+double DriftController::update(uint64_t now_ns, double drift_seconds) {
+    if (has_drift) {
+        double interval_ms = (now_ns - last_ns) / 1e6;
+        corrected_ms += rate_ppm * 1e-6 * interval_ms;
+        drift_ms += (drift_seconds * 1000.0 - drift_ms) * kSmoothing;
+    }
+    else {
+        drift_ms = drift_seconds * 1000.0;
+        has_drift = true;
+    }
+    last_ns = now_ns;
+
+    double ppm = drift_ms / 1000.0 / correction_seconds * 1e6;
+    return ppm > max_ppm ? max_ppm : (ppm < -max_ppm ? -max_ppm : ppm);
+}
+
+void DriftController::setApplied(double ppm) {
+    rate_ppm = ppm;
+}
+
+double DriftController::getDriftMs() const {
+    return drift_ms;
+}
+
+double DriftController::getRatePpm() const {
+    return rate_ppm;
+}
+
+double DriftController::getCorrectedMs() const {
+    return corrected_ms;
+}
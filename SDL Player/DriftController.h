@@ -0,0 +1,47 @@
+#ifndef DRIFT_CONTROLLER_H
+#define DRIFT_CONTROLLER_H
+
+#include <cstdint>
+
+/// System-clock mode: turns the measured drift of the audio clock against
+/// the system clock into a resampler rate adjustment, so the drift is
+/// worked off over a few seconds instead of being dropped or repeated.
+///
+/// A proportional controller on the smoothed drift. A device running
+/// 'd' ppm off the system clock settles at a steady 'd' ppm adjustment and
+/// d * correction_seconds of residual drift (1 ms for 100 ppm over 10 s).
+/// The audio clock must already include the stretch being applied (see
+/// MediaClock), or the loop only sees it in coarse steps and saws.
+class DriftController {
+public:
+    DriftController(double correction_seconds, double max_ppm);
+
+    /// One drift measurement (audio clock minus system clock, in seconds,
+    /// positive when audio is ahead) taken at 'now_ns'. Returns the
+    /// adjustment to request in ppm; positive stretches the audio.
+    double update(uint64_t now_ns, double drift_seconds);
+
+    /// What the resampler actually applied after rounding; the corrected
+    /// total integrates this, not the request.
+    void setApplied(double ppm);
+
+    double getDriftMs() const;     // smoothed
+    double getRatePpm() const;     // applied
+    double getCorrectedMs() const; // total stretch (+) / squeeze (-) so far
+
+private:
+    // Callback granularity makes single readings noisy; this averages over
+    // about ten of them
+    static constexpr double kSmoothing = 0.1;
+
+    const double correction_seconds;
+    const double max_ppm;
+
+    bool has_drift;
+    uint64_t last_ns;
+    double drift_ms;
+    double rate_ppm;
+    double corrected_ms;
+};
+
+#endif // DRIFT_CONTROLLER_H
@@ -0,0 +1,195 @@
+#include "FrameConverter.h"
+#include <iostream>
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+}
+
+FrameConverter::FrameConverter() {
+	rgb_frame = av_frame_alloc();
+}
+
+FrameConverter::~FrameConverter() {
+	av_frame_free(&rgb_frame);
+	av_free(rgb_buffer);
+}
+
+void FrameConverter::setTargetSize(int width, int height) {
+	// The scaler is rebuilt (or fetched from the cache) on the next frame
+	target_width = width;
+	target_height = height;
+}
+
+// Anamorphic content stores non-square pixels; unknown means square
+static AVRational sampleAspectOrSquare(AVRational sar) {
+	if (sar.num <= 0 || sar.den <= 0) {
+		return AVRational{ 1, 1 };
+	}
+	return sar;
+}
+
+void FrameConverter::computeOutputSize(int src_w, int src_h, AVRational sar, int& dst_w, int& dst_h) const {
+	dst_w = src_w;
+	dst_h = src_h;
+
+	// The shape the picture is shown at, the same aspect prepare() reports
+	sar = sampleAspectOrSquare(sar);
+	int64_t display_w = av_rescale(src_w, sar.num, sar.den);
+	if (display_w < 1) display_w = 1;
+
+	// Only ever downscale here; upscaling is cheaper on the GPU
+	if (target_width <= 0 || target_height <= 0 ||
+		(src_w <= target_width && display_w <= target_width && src_h <= target_height)) {
+		return;
+	}
+
+	// Fit the displayed shape inside the target, so the output has square pixels
+	if (display_w * target_height > (int64_t)src_h * target_width) {
+		dst_w = target_width;
+		dst_h = (int)av_rescale(src_h, target_width, display_w);
+	}
+	else {
+		dst_h = target_height;
+		dst_w = (int)av_rescale(display_w, target_height, src_h);
+	}
+	if (dst_w < 1) dst_w = 1;
+	if (dst_h < 1) dst_h = 1;
+}
+
+bool FrameConverter::setup(int src_w, int src_h, AVPixelFormat src_fmt, const ColorMatrix& colors, AVRational sar) {
+	// 4 bytes per pixel keeps every row naturally aligned and matches the
+	// GL_BGRA upload format, so the renderer can take any stride directly
+	AVPixelFormat dst_fmt = AV_PIX_FMT_BGRA;
+
+	int width, height;
+	computeOutputSize(src_w, src_h, sar, width, height);
+
+	sws_ctx = scaler_cache.get(
+		src_w, src_h, src_fmt,
+		width, height, dst_fmt,
+		SWS_BILINEAR, colors
+	);
+	if (!sws_ctx) {
+		src_width = src_height = 0;
+		src_format = AV_PIX_FMT_NONE;
+		src_colors = nullptr;
+		return false;
+	}
+
+	src_width = src_w;
+	src_height = src_h;
+	src_format = src_fmt;
+	src_colors = &colors;
+
+	// Pad rows to 32 bytes so swscale can use its aligned SIMD paths
+	int linesizes[4];
+	av_image_fill_linesizes(linesizes, dst_fmt, FFALIGN(width, 8));
+	out_width = width;
+	out_height = height;
+	out_linesize = linesizes[0];
+
+	return true;
+}
+
+bool FrameConverter::prepare(const AVFrame* frame) {
+	// Adaptive streams and spliced captures can change resolution or
+	// pixel format mid-stream, so check every frame before converting
+	// (or the target size was changed by a window resize). Colour tags can
+	// change at splice points too, and pick a different matrix.
+	AVPixelFormat frame_fmt = (AVPixelFormat)frame->format;
+	const ColorMatrix& colors = colorMatrixFor(frame->colorspace, frame->color_range, frame->height);
+	AVRational sar = sampleAspectOrSquare(frame->sample_aspect_ratio);
+	int want_w, want_h;
+	computeOutputSize(frame->width, frame->height, sar, want_w, want_h);
+	if (frame->width != src_width || frame->height != src_height ||
+		frame_fmt != src_format || &colors != src_colors ||
+		want_w != out_width || want_h != out_height) {
+		if (!setup(frame->width, frame->height, frame_fmt, colors, sar)) {
+			return false;
+		}
+	}
+	if (frame->color_primaries != src_primaries || frame->color_trc != src_trc) {
+		logColorInfo(frame);
+	}
+
+	display_aspect = (double)frame->width * sar.num / ((double)frame->height * sar.den);
+	return true;
+}
+
+bool FrameConverter::ensureRGBBuffer() {
+	if (rgb_buffer && rgb_frame->width == out_width && rgb_frame->height == out_height) {
+		return true;
+	}
+
+	av_free(rgb_buffer);
+
+	int num_bytes = out_linesize * out_height;
+	rgb_buffer = (uint8_t*)av_malloc(num_bytes * sizeof(uint8_t));
+	if (!rgb_buffer) {
+		std::cerr << "Failed to allocate BGRA buffer\n";
+		rgb_frame->width = rgb_frame->height = 0;
+		return false;
+	}
+
+	rgb_frame->data[0] = rgb_buffer;
+	rgb_frame->linesize[0] = out_linesize;
+	rgb_frame->width = out_width;
+	rgb_frame->height = out_height;
+	rgb_frame->format = AV_PIX_FMT_BGRA;
+	return true;
+}
+
+void FrameConverter::convert(const AVFrame* frame, uint8_t* dst, int dst_linesize) {
+	ScopedStageTimer timer(convert_timing);
+	uint8_t* dst_data[4] = { dst, nullptr, nullptr, nullptr };
+	int dst_linesizes[4] = { dst_linesize, 0, 0, 0 };
+
+	// Convert YUV -> BGRA
+	sws_scale(
+		sws_ctx,
+		frame->data, frame->linesize,
+		0, frame->height,
+		dst_data, dst_linesizes
+	);
+}
+
+AVFrame* FrameConverter::convert(const AVFrame* frame) {
+	if (!ensureRGBBuffer()) {
+		return nullptr;
+	}
+
+	convert(frame, rgb_frame->data[0], rgb_frame->linesize[0]);
+	return rgb_frame;
+}
+
+void FrameConverter::logColorInfo(const AVFrame* frame) {
+	src_primaries = frame->color_primaries;
+	src_trc = frame->color_trc;
+
+	// Primaries and transfer are reported only; the RGB output assumes an
+	// SDR display in the source gamut
+	std::cout << "Colour: matrix " << av_color_space_name(frame->colorspace)
+		<< ", range " << av_color_range_name(frame->color_range)
+		<< ", primaries " << av_color_primaries_name(frame->color_primaries)
+		<< ", transfer " << av_color_transfer_name(frame->color_trc) << "\n";
+}
+
+int FrameConverter::getWidth() const {
+	return out_width;
+}
+
+int FrameConverter::getHeight() const {
+	return out_height;
+}
+
+int FrameConverter::getOutputLinesize() const {
+	return out_linesize;
+}
+
+double FrameConverter::getDisplayAspect() const {
+	return display_aspect;
+}
+
+const StageTiming& FrameConverter::getConvertTiming() const {
+	return convert_timing;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libswscale/swscale.h>
+#include <libavutil/imgutils.h>
+}
+
+#include "PlaybackStats.h"
+#include "ScalerCache.h"
+
+// Turns decoded frames into BGRA for upload. Tracks the source geometry,
+// pixel format and colour tags frame by frame and swaps scalers (through
+// the cache) whenever any of them, or the target size, changes.
+class FrameConverter {
+public:
+	FrameConverter();
+	~FrameConverter();
+
+	FrameConverter(const FrameConverter&) = delete;
+	FrameConverter& operator=(const FrameConverter&) = delete;
+
+	// Largest size worth converting to, normally the window's pixel size.
+	// Bigger sources are downscaled in swscale instead of minified on the GPU.
+	// 0x0 converts at the source resolution. Takes effect on the next prepare().
+	void setTargetSize(int width, int height);
+
+	// Sets the scaler up ahead of the first frame when the stream parameters
+	// are already known. 'sar' is the sample aspect ratio, 0/0 for unknown.
+	bool setup(int src_w, int src_h, AVPixelFormat src_fmt, const ColorMatrix& colors, AVRational sar);
+
+	// Readies the scaler and output geometry for 'frame'; call before convert()
+	bool prepare(const AVFrame* frame);
+	void convert(const AVFrame* frame, uint8_t* dst, int dst_linesize);
+	AVFrame* convert(const AVFrame* frame); // into the converter's own buffer
+
+	int getWidth() const;          // output size, 0 before the first setup
+	int getHeight() const;
+	int getOutputLinesize() const; // bytes per BGRA row convert() expects at least
+	double getDisplayAspect() const; // picture aspect of the last prepared frame, sample aspect applied
+
+	const StageTiming& getConvertTiming() const;
+
+private:
+	void logColorInfo(const AVFrame* frame);
+	bool ensureRGBBuffer();
+	void computeOutputSize(int src_w, int src_h, AVRational sar, int& dst_w, int& dst_h) const;
+
+	ScalerCache scaler_cache;
+	SwsContext* sws_ctx = nullptr; // owned by scaler_cache
+
+	AVFrame* rgb_frame = nullptr;
+	uint8_t* rgb_buffer = nullptr;
+
+	// geometry the current scaler was set up for, checked on every frame
+	int src_width = 0;
+	int src_height = 0;
+	AVPixelFormat src_format = AV_PIX_FMT_NONE;
+	const ColorMatrix* src_colors = nullptr;
+	AVColorPrimaries src_primaries = AVCOL_PRI_UNSPECIFIED;
+	AVColorTransferCharacteristic src_trc = AVCOL_TRC_UNSPECIFIED;
+	int out_width = 0;
+	int out_height = 0;
+	int out_linesize = 0;
+	double display_aspect = 0.0;
+	int target_width = 0;
+	int target_height = 0;
+
+	StageTiming convert_timing;
+};
@@ -0,0 +1,71 @@
+#include "FrameQueue.h"
+
+FrameQueue::FrameQueue(int capacity)
+	: frames(capacity > 0 ? capacity : 1, nullptr), pts_values(frames.size(), 0.0) {
+	for (AVFrame*& frame : frames) {
+		frame = av_frame_alloc();
+	}
+}
+
+FrameQueue::~FrameQueue() {
+	for (AVFrame*& frame : frames) {
+		av_frame_free(&frame);
+	}
+}
+
+bool FrameQueue::push(AVFrame* frame, double pts) {
+	std::unique_lock<std::mutex> lock(mutex);
+	not_full.wait(lock, [this] { return closed || count < (int)frames.size(); });
+	if (closed) {
+		return false;
+	}
+
+	int tail = (head + count) % (int)frames.size();
+	av_frame_move_ref(frames[tail], frame);
+	pts_values[tail] = pts;
+	++count;
+	return true;
+}
+
+void FrameQueue::finish() {
+	std::lock_guard<std::mutex> lock(mutex);
+	finished = true;
+}
+
+bool FrameQueue::tryPop(AVFrame* frame, double& pts) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (count == 0) {
+			return false;
+		}
+		av_frame_unref(frame);
+		av_frame_move_ref(frame, frames[head]);
+		pts = pts_values[head];
+		head = (head + 1) % (int)frames.size();
+		--count;
+	}
+	not_full.notify_one();
+	return true;
+}
+
+bool FrameQueue::isDrained() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return finished && count == 0;
+}
+
+void FrameQueue::close() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+	}
+	not_full.notify_all();
+}
+
+int FrameQueue::size() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return count;
+}
+
+int FrameQueue::capacity() const {
+	return (int)frames.size();
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+// Bounded hand-off of decoded frames from the decode thread to the render
+// thread. Frames are moved in and out by reference (av_frame_move_ref), so
+// nothing is copied and the slots are allocated once up front.
+class FrameQueue {
+public:
+	explicit FrameQueue(int capacity);
+	~FrameQueue();
+
+	FrameQueue(const FrameQueue&) = delete;
+	FrameQueue& operator=(const FrameQueue&) = delete;
+
+	// Producer: takes the frame's references, waiting while the queue is
+	// full. Returns false (frame untouched) once the queue has been closed.
+	bool push(AVFrame* frame, double pts);
+	void finish(); // no more frames are coming
+
+	// Consumer, never blocks: moves the oldest frame into 'frame'
+	bool tryPop(AVFrame* frame, double& pts);
+	bool isDrained() const; // finished and empty
+
+	// Shutdown: wakes a waiting producer and refuses further frames
+	void close();
+
+	int size() const;
+	int capacity() const;
+
+private:
+	mutable std::mutex mutex;
+	std::condition_variable not_full;
+	std::vector<AVFrame*> frames;
+	std::vector<double> pts_values;
+	int head = 0;
+	int count = 0;
+	bool finished = false;
+	bool closed = false;
+};
@@ -0,0 +1,126 @@
+#include "FrameScheduler.h"
+
+FrameScheduler::FrameScheduler()
+	: refresh_ns(SDL_NS_PER_SECOND / 60) {
+}
+
+void FrameScheduler::setNominalRefresh(float hz) {
+	if (hz > 0.0f) {
+		refresh_ns = (Uint64)(SDL_NS_PER_SECOND / hz);
+	}
+}
+
+void FrameScheduler::setVsync(bool enabled) {
+	vsync = enabled;
+}
+
+void FrameScheduler::onPresented(Uint64 now_ns, Uint64 due_ns) {
+	// Vblanks since the previous swap. The loop only swaps when something
+	// changed, so at 24-30 fps on 60 Hz that's usually 2 or 3
+	Uint64 intervals = 1;
+	if (last_vblank_ns != 0) {
+		Uint64 delta = now_ns - last_vblank_ns;
+		intervals = (delta + refresh_ns / 2) / refresh_ns;
+
+		// With vsync the gap is a whole number of refresh intervals; refine
+		// the estimate from any gap that lands close to the grid. Long idle
+		// gaps and a missed vblank or window drag (off the grid) are ignored.
+		if (vsync && intervals >= 1 && intervals <= kMaxRefineIntervals) {
+			Uint64 grid = intervals * refresh_ns;
+			Uint64 error = delta > grid ? delta - grid : grid - delta;
+			if (error < refresh_ns / 4) {
+				refresh_ns = (refresh_ns * 15 + delta / intervals) / 16;
+			}
+		}
+	}
+	last_vblank_ns = now_ns;
+
+	// Every vblank that passed without a new picture: the ones skipped
+	// between swaps, plus this one if it only re-presented
+	if (intervals > 1) {
+		repeated += intervals - 1;
+	}
+
+	if (due_ns != 0) {
+		if (last_new_frame_ns != 0) {
+			frame_intervals.add((now_ns - last_new_frame_ns) / 1e6);
+		}
+		last_new_frame_ns = now_ns;
+		present_error.add(((double)now_ns - (double)due_ns) / 1e6);
+	}
+	else {
+		++repeated;
+	}
+}
+
+Uint64 FrameScheduler::nextVblankNS(Uint64 now_ns) const {
+	if (last_vblank_ns == 0) {
+		return now_ns;
+	}
+
+	Uint64 next = last_vblank_ns + refresh_ns;
+	if (next <= now_ns) {
+		// Missed some; step forward on the grid from the last one we saw
+		Uint64 behind = (now_ns - last_vblank_ns) / refresh_ns;
+		next = last_vblank_ns + (behind + 1) * refresh_ns;
+	}
+	return next;
+}
+
+bool FrameScheduler::isDue(Uint64 due_ns, Uint64 now_ns) const {
+	// Show the frame on the vblank nearest its due time, so half an interval
+	// early is fine; this keeps e.g. 24 fps on 60 Hz in a steady 3:2 cadence
+	return due_ns <= nextVblankNS(now_ns) + refresh_ns / 2;
+}
+
+bool FrameScheduler::isLate(Uint64 due_ns, Uint64 now_ns) const {
+	return due_ns + refresh_ns < nextVblankNS(now_ns);
+}
+
+Uint64 FrameScheduler::wakeTimeNS(Uint64 due_ns) const {
+	// The frame goes up on the first vblank at or after due - refresh/2, so
+	// it becomes due as soon as the vblank before that one has passed
+	Uint64 threshold = due_ns > refresh_ns / 2 ? due_ns - refresh_ns / 2 : 0;
+	if (last_vblank_ns == 0 || threshold <= last_vblank_ns) {
+		return 0;
+	}
+
+	Uint64 steps = (threshold - last_vblank_ns + refresh_ns - 1) / refresh_ns;
+	return last_vblank_ns + (steps - 1) * refresh_ns;
+}
+
+void FrameScheduler::waitForVblank() {
+	if (vsync || last_vblank_ns == 0) {
+		return;
+	}
+
+	Uint64 now = SDL_GetTicksNS();
+	Uint64 target = nextVblankNS(now);
+	if (target > now) {
+		SDL_DelayPrecise(target - now);
+	}
+}
+
+void FrameScheduler::onDropped() {
+	++dropped;
+}
+
+Uint64 FrameScheduler::getRefreshIntervalNS() const {
+	return refresh_ns;
+}
+
+const IntervalStats& FrameScheduler::getFrameIntervals() const {
+	return frame_intervals;
+}
+
+const IntervalStats& FrameScheduler::getPresentError() const {
+	return present_error;
+}
+
+uint64_t FrameScheduler::getDroppedFrames() const {
+	return dropped;
+}
+
+uint64_t FrameScheduler::getRepeatedVblanks() const {
+	return repeated;
+}
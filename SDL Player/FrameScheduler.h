@@ -0,0 +1,61 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include "PlaybackStats.h"
+
+// Decides which vblank each video frame is presented at.
+// Works in SDL_GetTicksNS() nanoseconds throughout. The refresh interval is
+// measured from the actual swap timestamps (vsync on), so a frame's due time
+// can be mapped to a concrete vblank instead of sleeping in whole
+// milliseconds.
+class FrameScheduler {
+public:
+	FrameScheduler();
+
+	void setNominalRefresh(float hz); // starting estimate, e.g. from the display mode
+	void setVsync(bool enabled);
+
+	// Call right after SDL_GL_SwapWindow returns; due_ns is the due time of
+	// the frame that just went up, or 0 if the previous one was repeated
+	void onPresented(Uint64 now_ns, Uint64 due_ns);
+
+	// The vblank the next swap will land on
+	Uint64 nextVblankNS(Uint64 now_ns) const;
+
+	// True if a frame due at 'due_ns' belongs on the next vblank (or is late)
+	bool isDue(Uint64 due_ns, Uint64 now_ns) const;
+
+	// True if the frame is so late its vblank has already passed; showing it
+	// would only push every later frame back
+	bool isLate(Uint64 due_ns, Uint64 now_ns) const;
+
+	// Earliest time isDue() can turn true for 'due_ns' (0 = already), so the
+	// loop can sleep until then instead of spinning
+	Uint64 wakeTimeNS(Uint64 due_ns) const;
+
+	// Without vsync nothing blocks in the swap, so wait for the vblank here
+	void waitForVblank();
+
+	void onDropped();
+
+	Uint64 getRefreshIntervalNS() const;
+	const IntervalStats& getFrameIntervals() const; // between new frames on screen
+	const IntervalStats& getPresentError() const;   // actual present - due time; stddev is the jitter
+	uint64_t getDroppedFrames() const;
+	uint64_t getRepeatedVblanks() const; // vblanks that showed no new frame, swapped or not
+
+private:
+	// Gaps longer than this (idle, paused) are too coarse to refine from
+	static const Uint64 kMaxRefineIntervals = 8;
+
+	bool vsync = true;
+	Uint64 refresh_ns;
+	Uint64 last_vblank_ns = 0;
+	Uint64 last_new_frame_ns = 0;
+
+	IntervalStats frame_intervals;
+	IntervalStats present_error;
+	uint64_t dropped = 0;
+	uint64_t repeated = 0;
+};
@@ -1,54 +1,600 @@
 #include <SDL3/SDL.h>
 #include <iostream>
+#include <fstream>
 #include <vector>
 #include <cstring>
 
 #include "VideoDecoder.h"
+#include "FrameConverter.h"
+#include "FrameQueue.h"
 #include "VideoRenderer.h"
 #include "AudioDecoder.h"
+#include "AudioRingBuffer.h"
+#include "AudioPlayer.h"
+#include "MediaClock.h"
+#include "DriftController.h"
+#include "FrameScheduler.h"
+#include "OffscreenTarget.h"
+#include "PerformanceHud.h"
+#include "ShaderProgram.h"
 #include <mutex>
 #include <condition_variable>
+#include <thread>
+#include <chrono>
+
+// How long the window size has to stay put before the scaler is rebuilt
+const Uint64 kResizeDebounceMs = 150;
+
+// Frame textures rotated by the renderer; deeper hides more GPU latency
+const int kTextureRingDepth = 3;
+
+// Decoded frames buffered between the decode and render threads
+const int kFrameQueueDepth = 4;
+
+// Decoded audio buffered ahead of the device. The audio thread tops the
+// ring up to the high watermark and then sleeps until it drains to the low
+// one; playback starts once the low watermark is first reached.
+const int kAudioRingMs = 1000;
+const int kAudioLowWaterMs = 150;
+const int kAudioHighWaterMs = 400;
+
+// With --system-clock, audio is stretched to follow SDL ticks: the drift is
+// measured this often and worked off over kDriftCorrectionSeconds, never
+// faster than kMaxRateAdjustPpm (far below anything audible)
+const int kDriftCheckMs = 500;
+const double kDriftCorrectionSeconds = 10.0;
+const double kMaxRateAdjustPpm = 500.0;
+
+// Converts a decoded frame (already prepare()d) and hands it to the renderer
+static void uploadFrame(FrameConverter& converter, const AVFrame* frame, VideoRenderer& renderer) {
+    int width = converter.getWidth();
+    int height = converter.getHeight();
+    int linesize = converter.getOutputLinesize();
+
+    // Resolution can change mid-stream
+    renderer.resize(width, height);
+    renderer.setDisplayAspect(converter.getDisplayAspect());
+
+    // swscale writes straight into mapped GL memory, so the texture
+    // update is a GPU-side copy with no CPU memcpy in between
+    uint8_t* staging = renderer.acquireUploadBuffer(linesize);
+    if (staging) {
+        converter.convert(frame, staging, linesize);
+        renderer.commitUpload();
+    }
+    else if (AVFrame* rgb = converter.convert(frame)) {
+        renderer.uploadFrame(rgb->data[0], rgb->linesize[0]);
+    }
+}
+
+// Decode-thread figures the HUD shows, republished after every frame
+struct DecodeStats {
+    StageTiming demux;
+    StageTiming decode;
+    bool deinterlacing = false;
+    double deinterlaceMs = 0.0;
+};
+
+// Audio-thread figures for the system-clock mode, republished per check
+struct AudioSyncStats {
+    bool active = false;
+    double driftMs = 0.0;     // audio clock - system clock, smoothed
+    double ratePpm = 0.0;     // adjustment currently applied
+    double correctedMs = 0.0; // total stretch (+) / squeeze (-) applied so far
+};
+
+// What the event loop and the decode thread hand to the render thread,
+// all under one lock. The render thread sleeps on 'wake' when there is
+// nothing to draw; anything that might change that sets 'signalled'.
+struct PlayerShared {
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable audioWake; // audio thread sleeps on this
+    bool signalled = false;
+
+    // commands from the event loop
+    bool quit = false;
+    bool exposed = false;
+    bool resized = false;
+    bool cycleFilter = false;
+    bool toggleHud = false;
+    int windowWidth = 0, windowHeight = 0;
+
+    DecodeStats decodeStats;
+    AudioSyncStats audioSync;
+};
+
+// Everything the render thread works with; it owns the GL context while it runs
+struct RenderThreadContext {
+    SDL_Window* window;
+    SDL_GLContext glContext;
+    VideoRenderer& renderer;
+    PerformanceHud& hud;
+    FrameScheduler& scheduler;
+    FrameConverter& converter;
+    FrameQueue& queue;
+    PlayerShared& shared;
+    StageTiming& presentTiming;
+    const AudioRingBuffer& audioRing;
+    const AudioPlayer& audioPlayer;
+    double audioBytesPerMs;
+    MediaClock& clock;
+    IntervalStats& avSync; // presented pts - audio clock, per new frame
+};
+
+static void addStageLine(PerformanceHud& hud, const char* name, const StageTiming& timing) {
+    hud.addLine("%-8s%6.2f ms  avg %6.2f  max %6.2f", name, timing.last_ms, timing.average(), timing.max_ms);
+}
+
+// Refreshes the overlay text from the live counters, just before it's drawn
+static void updateHud(PerformanceHud& hud, const DecodeStats& decodeStats, const FrameConverter& converter,
+    const VideoRenderer& renderer, const FrameScheduler& scheduler, const StageTiming& presentTiming,
+    int videoQueued, double audioBufferedMs, uint64_t audioUnderruns, bool clockLive, ClockMaster master,
+    double avOffsetMs, const AudioSyncStats& audioSync) {
+    hud.clearText();
+    hud.addLine("%dx%d  %s  refresh %.2f ms", converter.getWidth(), converter.getHeight(),
+        VideoRenderer::scaleFilterName(renderer.getScaleFilter()), scheduler.getRefreshIntervalNS() / 1e6);
+    addStageLine(hud, "demux", decodeStats.demux);
+    addStageLine(hud, "decode", decodeStats.decode);
+    if (decodeStats.deinterlacing) {
+        hud.addLine("%-8s        avg %6.2f", "deint", decodeStats.deinterlaceMs);
+    }
+    addStageLine(hud, "convert", converter.getConvertTiming());
+    addStageLine(hud, "upload", renderer.getUploadTiming());
+    addStageLine(hud, "present", presentTiming);
+    addStageLine(hud, "hud", hud.getDrawTiming());
+    hud.addLine("queue   video %d", videoQueued);
+    hud.addLine("dropped %llu  repeated %llu", (unsigned long long)scheduler.getDroppedFrames(),
+        (unsigned long long)scheduler.getRepeatedVblanks());
+    hud.addLine("audio   %.0f ms buffered  underruns %llu", audioBufferedMs,
+        (unsigned long long)audioUnderruns);
+    if (clockLive) {
+        hud.addLine("clock   %s  A-V %+.1f ms", master == CLOCK_MASTER_SYSTEM ? "system" : "audio", avOffsetMs);
+    }
+    else {
+        hud.addLine("clock   wall");
+    }
+    if (audioSync.active) {
+        hud.addLine("drift   %+.2f ms  rate %+.1f ppm  total %+.1f ms", audioSync.driftMs,
+            audioSync.ratePpm, audioSync.correctedMs);
+    }
+}
+
+// Decode thread: demux, decode and deinterlace into the frame queue, which
+// blocks it once it is far enough ahead
+static void runDecodeThread(VideoDecoder& videoDecoder, FrameQueue& queue, PlayerShared& shared) {
+    while (videoDecoder.decodeSourceFrame()) {
+        {
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            shared.decodeStats.demux = videoDecoder.getDemuxTiming();
+            shared.decodeStats.decode = videoDecoder.getDecodeTiming();
+            shared.decodeStats.deinterlacing = videoDecoder.getDeinterlacer().isActive();
+            shared.decodeStats.deinterlaceMs = videoDecoder.getDeinterlacer().getAverageMs();
+        }
+
+        if (!queue.push(videoDecoder.getSourceFrame(), videoDecoder.getFramePts())) {
+            return; // shutting down
+        }
+        {
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            shared.signalled = true;
+        }
+        shared.wake.notify_one();
+    }
+
+    queue.finish();
+}
+
+// Sample formats both sides understand. Devices that want something else
+// (8-bit, big-endian) get float, which SDL converts for them
+static AVSampleFormat toSampleFormat(SDL_AudioFormat format) {
+    switch (format) {
+    case SDL_AUDIO_S16: return AV_SAMPLE_FMT_S16;
+    case SDL_AUDIO_S32: return AV_SAMPLE_FMT_S32;
+    default:            return AV_SAMPLE_FMT_FLT;
+    }
+}
+
+static SDL_AudioFormat toSDLAudioFormat(AVSampleFormat format) {
+    switch (format) {
+    case AV_SAMPLE_FMT_S16: return SDL_AUDIO_S16;
+    case AV_SAMPLE_FMT_S32: return SDL_AUDIO_S32;
+    default:                return SDL_AUDIO_F32;
+    }
+}
+
+// Sleeps on the audio thread's condition for up to 'ms'; false once quitting
+static bool waitForAudioDrain(PlayerShared& shared, double ms) {
+    std::unique_lock<std::mutex> lock(shared.mutex);
+    shared.audioWake.wait_for(lock, std::chrono::duration<double, std::milli>(ms),
+        [&shared] { return shared.quit; });
+    return !shared.quit;
+}
+
+// Audio thread: keeps the ring between the watermarks regardless of the
+// video frame rate. Has its own demuxer, so it never waits on video.
+static void runAudioThread(AudioDecoder& audioDecoder, AudioRingBuffer& audioRing,
+    AudioPlayer& audioPlayer, MediaClock& clock, PlayerShared& shared, double bytesPerMs) {
+    bool started = false;
+
+    // System-clock mode: drift controller state
+    const bool followSystemClock = clock.getMaster() == CLOCK_MASTER_SYSTEM;
+    Uint64 lastDriftCheckNS = 0;
+    DriftController driftController(kDriftCorrectionSeconds, kMaxRateAdjustPpm);
+    AudioSyncStats sync;
+    sync.active = followSystemClock;
+
+    while (true) {
+        double bufferedMs = audioRing.size() / bytesPerMs;
+        if (!started && bufferedMs >= kAudioLowWaterMs) {
+            audioPlayer.resume();
+            started = true;
+        }
+
+        // Full enough: the device drains the ring in real time, so sleep
+        // until it is due to reach the low watermark
+        if (bufferedMs >= kAudioHighWaterMs) {
+            if (!waitForAudioDrain(shared, bufferedMs - kAudioLowWaterMs)) {
+                break;
+            }
+            continue;
+        }
+
+        // Decode straight into the ring up to the high watermark
+        size_t targetBytes = (size_t)((kAudioHighWaterMs - bufferedMs) * bytesPerMs);
+        if (!audioDecoder.decodeInto(audioRing, targetBytes)) {
+            audioPlayer.setEndOfStream(); // the ring running dry is expected now
+            break;
+        }
+
+        double anchorPts;
+        uint64_t anchorFrame;
+        if (audioDecoder.takeTimestampAnchor(anchorPts, anchorFrame)) {
+            clock.setAnchor(anchorPts, anchorFrame);
+        }
+
+        // Stretch or squeeze by a few ppm rather than drop or repeat audio
+        Uint64 now = SDL_GetTicksNS();
+        double driftSeconds;
+        bool driftChecked = false;
+        if (followSystemClock && now - lastDriftCheckNS >= SDL_MS_TO_NS(kDriftCheckMs) &&
+            clock.getDrift(now, driftSeconds)) {
+            audioDecoder.setRateAdjustment(driftController.update(now, driftSeconds));
+            driftController.setApplied(audioDecoder.getRateAdjustment());
+            sync.driftMs = driftController.getDriftMs();
+            sync.ratePpm = driftController.getRatePpm();
+            sync.correctedMs = driftController.getCorrectedMs();
+            lastDriftCheckNS = now;
+            driftChecked = true;
+        }
+
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        if (driftChecked) {
+            shared.audioSync = sync;
+        }
+        if (shared.quit) {
+            break;
+        }
+    }
+
+    // Short files may never reach the low watermark
+    if (!started) {
+        audioPlayer.resume();
+    }
+}
+
+// Render thread: picks frames off the queue when their vblank comes up,
+// converts, uploads and presents. Window events only reach it as commands,
+// so a stalled event loop (e.g. a compositor holding a window drag) no
+// longer holds up presentation.
+static void runRenderThread(RenderThreadContext& ctx) {
+    SDL_GL_MakeCurrent(ctx.window, ctx.glContext);
+
+    AVFrame* frame = av_frame_alloc();
+    int windowWidth = 0, windowHeight = 0;
+    SDL_GetWindowSizeInPixels(ctx.window, &windowWidth, &windowHeight);
+
+    bool resizePending = false;
+    Uint64 resizeDeadline = 0;
+
+    // Frame waiting for its vblank, and the stream time -> wall clock mapping
+    bool framePending = false;
+    double framePts = 0.0;
+    Uint64 frameDueNS = 0;
+    Uint64 playbackStartNS = 0;
+    double playbackStartPts = 0.0;
+    double presentedPts = 0.0;
+    double avOffsetMs = 0.0;
+
+    // Set whenever what's on screen is stale: new frame, expose, resize,
+    // overlay change. Nothing else is worth a clear/draw/swap.
+    bool needsRedraw = true;
+
+    while (true) {
+        bool exposed, resized, cycleFilter, toggleHud;
+        DecodeStats decodeStats;
+        AudioSyncStats audioSync;
+        {
+            std::lock_guard<std::mutex> lock(ctx.shared.mutex);
+            if (ctx.shared.quit) {
+                break;
+            }
+            exposed = ctx.shared.exposed;
+            resized = ctx.shared.resized;
+            cycleFilter = ctx.shared.cycleFilter;
+            toggleHud = ctx.shared.toggleHud;
+            if (resized) {
+                windowWidth = ctx.shared.windowWidth;
+                windowHeight = ctx.shared.windowHeight;
+            }
+            if (ctx.hud.isVisible() || toggleHud) {
+                decodeStats = ctx.shared.decodeStats;
+                audioSync = ctx.shared.audioSync;
+            }
+            ctx.shared.exposed = ctx.shared.resized = false;
+            ctx.shared.cycleFilter = ctx.shared.toggleHud = false;
+            ctx.shared.signalled = false;
+        }
+
+        if (exposed) {
+            needsRedraw = true;
+        }
+        if (resized) {
+            ctx.renderer.setViewport(windowWidth, windowHeight); // cheap, no debounce
+            ctx.hud.setViewport(windowWidth, windowHeight);
+            resizePending = true;
+            resizeDeadline = SDL_GetTicks() + kResizeDebounceMs;
+            needsRedraw = true;
+        }
+        if (cycleFilter) {
+            // F cycles the GPU scaling filter
+            ScaleFilter next = (ScaleFilter)((ctx.renderer.getScaleFilter() + 1) % SCALE_FILTER_COUNT);
+            ctx.renderer.setScaleFilter(next);
+            needsRedraw = true;
+            std::cout << "Scaling filter: " << VideoRenderer::scaleFilterName(next) << "\n";
+        }
+        if (toggleHud) {
+            ctx.hud.setVisible(!ctx.hud.isVisible());
+            needsRedraw = true;
+        }
+
+        // Don't rebuild the scaler on every pixel of a window drag
+        if (resizePending && SDL_GetTicks() >= resizeDeadline) {
+            ctx.converter.setTargetSize(windowWidth, windowHeight);
+            resizePending = false;
+        }
+
+        // Take the next frame off the queue so its vblank can be worked out.
+        // While the media clock runs it is the timeline, so the mapping is
+        // re-pinned to it every pass; without it (audio not started yet,
+        // ended, stalled) the last mapping carries on with the wall clock
+        Uint64 now = SDL_GetTicksNS();
+        double clockPts = 0.0;
+        bool clockLive = ctx.clock.getMasterTime(now, clockPts);
+        if (clockLive) {
+            playbackStartNS = now;
+            playbackStartPts = clockPts;
+        }
+        while (!framePending && ctx.queue.tryPop(frame, framePts)) {
+            double offset = framePts - playbackStartPts;
+            Uint64 behindNS = offset < 0.0 ? (Uint64)(-offset * 1e9) : 0;
+            Uint64 dueNS = offset >= 0.0 ? playbackStartNS + (Uint64)(offset * 1e9)
+                : (playbackStartNS > behindNS ? playbackStartNS - behindNS : 0);
+
+            // Behind the media clock means late, and isLate() drops it below.
+            // On the wall clock: first frame, or a timestamp jump (seek,
+            // splice, wrap), so restart the clock here
+            if (playbackStartNS == 0 || (!clockLive && (offset < 0.0 ||
+                (dueNS > now ? dueNS - now : now - dueNS) > SDL_NS_PER_SECOND))) {
+                playbackStartNS = now;
+                playbackStartPts = framePts;
+                dueNS = now;
+            }
+
+            // Its vblank has already gone; skip it rather than fall further behind
+            if (ctx.scheduler.isLate(dueNS, now)) {
+                ctx.scheduler.onDropped();
+                av_frame_unref(frame);
+                continue;
+            }
+
+            framePending = true;
+            frameDueNS = dueNS;
+        }
+
+        bool newFrame = false;
+        Uint64 presentedDueNS = frameDueNS;
+        if (framePending && ctx.scheduler.isDue(frameDueNS, now)) {
+            if (ctx.converter.prepare(frame)) {
+                uploadFrame(ctx.converter, frame, ctx.renderer);
+                newFrame = true;
+                presentedPts = framePts;
+            }
+            av_frame_unref(frame);
+            framePending = false;
+        }
+
+        if (newFrame) {
+            needsRedraw = true;
+        }
+
+        if (!needsRedraw) {
+            // Nothing changed: sleep until the next frame is due, the resize
+            // settles, or a command or new frame arrives, rather than
+            // re-presenting the same picture every vblank
+            Sint64 timeoutNS = -1;
+            if (framePending) {
+                Uint64 wake = ctx.scheduler.wakeTimeNS(frameDueNS);
+                timeoutNS = wake > now ? (Sint64)(wake - now) : 0;
+            }
+            if (resizePending) {
+                Uint64 deadlineNS = resizeDeadline * SDL_NS_PER_MS;
+                Sint64 resizeNS = deadlineNS > now ? (Sint64)(deadlineNS - now) : 0;
+                if (timeoutNS < 0 || resizeNS < timeoutNS) {
+                    timeoutNS = resizeNS;
+                }
+            }
 
-// Shared audio buffer and synchronization primitives
-std::vector<uint8_t> audioData;
-std::mutex audioMutex;
-std::condition_variable audioCondVar;
-size_t audioPos = 0;
+            std::unique_lock<std::mutex> lock(ctx.shared.mutex);
+            auto woken = [&ctx] { return ctx.shared.signalled; };
+            if (timeoutNS < 0) {
+                ctx.shared.wake.wait(lock, woken);
+            }
+            else if (timeoutNS > 0) {
+                ctx.shared.wake.wait_for(lock, std::chrono::nanoseconds(timeoutNS), woken);
+            }
+            continue;
+        }
 
-// Audio callback function
-void SDLCALL audioCallback(void* userdata, Uint8* stream, int len) {
-    std::unique_lock<std::mutex> lock(audioMutex);
+        // Clear screen
+        glClearColor(0, 0, 0, 1);
+        glClear(GL_COLOR_BUFFER_BIT);
 
-    // Clear output buffer first (avoid garbage sound)
-    SDL_memset(stream, 0, len);
+        ctx.renderer.render();
+
+        // Same pass, straight over the picture
+        if (ctx.hud.isVisible()) {
+            size_t audioQueued = ctx.audioRing.size() + ctx.audioPlayer.getQueuedBytes();
+            updateHud(ctx.hud, decodeStats, ctx.converter, ctx.renderer, ctx.scheduler, ctx.presentTiming,
+                ctx.queue.size() + (framePending ? 1 : 0), audioQueued / ctx.audioBytesPerMs,
+                ctx.audioPlayer.getUnderruns(), clockLive, ctx.clock.getMaster(), avOffsetMs, audioSync);
+            ctx.hud.draw();
+        }
 
-    // If no data, just silence
-    if (audioPos >= audioData.size()) {
-        return;
+        {
+            ScopedStageTimer timer(ctx.presentTiming);
+            ctx.scheduler.waitForVblank();
+            SDL_GL_SwapWindow(ctx.window);
+        }
+        Uint64 presentedNS = SDL_GetTicksNS();
+        ctx.scheduler.onPresented(presentedNS, newFrame ? presentedDueNS : 0);
+
+        // How far the picture that just went up is from what's being heard
+        double heardPts;
+        if (newFrame && ctx.clock.getTime(presentedNS, heardPts)) {
+            avOffsetMs = (presentedPts - heardPts) * 1000.0;
+            ctx.avSync.add(avOffsetMs);
+        }
+        if (newFrame && ctx.scheduler.getFrameIntervals().count > 0) {
+            ctx.hud.addFrameTime(ctx.scheduler.getFrameIntervals().last_ms);
+        }
+        needsRedraw = false;
     }
 
-    // Calculate how many bytes we can copy
-    int bytesAvailable = (int)(audioData.size() - audioPos);
-    int bytesToCopy = (len > bytesAvailable) ? bytesAvailable : len;
+    av_frame_free(&frame);
+    SDL_GL_MakeCurrent(ctx.window, nullptr);
+}
+
+// Batch mode: every frame is decoded, drawn into an FBO and optionally
+// dumped as raw BGRA, as fast as the machine allows. No window, no audio,
+// no pacing; runs until the end of the file.
+static int runHeadless(VideoDecoder& videoDecoder, FrameConverter& converter, VideoRenderer& renderer,
+    const char* dumpPath) {
+    OffscreenTarget target(videoDecoder.getWidth(), videoDecoder.getHeight()); // no target size, so full size
+    if (!target.isComplete()) {
+        return -1;
+    }
+    renderer.setRenderTarget(target.getFramebuffer());
+    renderer.setViewport(target.getWidth(), target.getHeight());
+
+    std::ofstream dump;
+    if (dumpPath) {
+        dump.open(dumpPath, std::ios::binary);
+        if (!dump) {
+            std::cerr << "Failed to open dump file: " << dumpPath << "\n";
+            return -1;
+        }
+    }
+    std::ostream* out = dumpPath ? &dump : nullptr;
 
-    // Copy audio data into stream buffer
-    SDL_memcpy(stream, audioData.data() + audioPos, bytesToCopy);
+    StageTiming renderTiming;
+    uint64_t frames = 0;
+    Uint64 startNS = SDL_GetTicksNS();
 
-    audioPos += bytesToCopy;
+    while (videoDecoder.decodeSourceFrame()) {
+        AVFrame* frame = videoDecoder.getSourceFrame();
+        if (!converter.prepare(frame)) {
+            break;
+        }
+        uploadFrame(converter, frame, renderer);
+
+        {
+            ScopedStageTimer timer(renderTiming);
+            glBindFramebuffer(GL_FRAMEBUFFER, target.getFramebuffer());
+            glClearColor(0, 0, 0, 1);
+            glClear(GL_COLOR_BUFFER_BIT);
+            renderer.render();
+            target.queueReadback(out);
+        }
 
-    // If we've consumed all data, reset buffer (or signal refill)
-    if (audioPos >= audioData.size()) {
-        audioData.clear();
-        audioPos = 0;
-        audioCondVar.notify_one(); // optional: notify main thread to decode more
+        // Pick up whatever the GPU has finished without waiting for it
+        target.collectReadbacks(out);
+        ++frames;
+    }
+    target.finish(out);
+
+    double seconds = (SDL_GetTicksNS() - startNS) / 1e9;
+    const StageTiming& upload = renderer.getUploadTiming();
+    const StageTiming& readback = target.getReadbackTiming();
+    std::cout << "Headless: " << frames << " frames in " << seconds << " s ("
+        << (seconds > 0.0 ? frames / seconds : 0.0) << " fps)\n";
+    std::cout << "Upload: avg " << upload.average() << " ms, render: avg "
+        << renderTiming.average() << " ms, readback: avg " << readback.average() << " ms\n";
+    if (dumpPath) {
+        std::cout << "Wrote " << target.getWidth() << "x" << target.getHeight()
+            << " raw BGRA frames to " << dumpPath << "\n";
     }
+    return 0;
+}
+
+// Headless runs usually fail for want of a GL driver, not for anything in
+// the file; say what is missing instead of just the SDL error
+static void explainHeadlessFailure() {
+    std::cerr << "Headless mode needs SDL's offscreen video driver and an EGL that can create "
+        "a desktop OpenGL 4.6 core context (e.g. Mesa llvmpipe). None was available.\n";
 }
 
 int main(int argc, char* argv[]) {
     const char* videoFile = "sample.mp4";
+    bool headless = false;
+    const char* dumpPath = nullptr;
+    bool forceResampler = false;
+    bool systemClock = false;
+    bool noPbo = false;
+
+    // usage: player [file] [--headless] [--dump frames.bgra] [--force-resampler] [--system-clock] [--no-pbo]
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        }
+        else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc) {
+            dumpPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--force-resampler") == 0) {
+            forceResampler = true; // audio through swr even when it could skip it
+        }
+        else if (strcmp(argv[i], "--system-clock") == 0) {
+            systemClock = true; // video on SDL ticks, audio stretched to follow
+        }
+        else if (strcmp(argv[i], "--no-pbo") == 0) {
+            noPbo = true; // direct texture uploads, to compare against the staging ring
+        }
+        else {
+            videoFile = argv[i];
+        }
+    }
 
-    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
+    // SDL's offscreen driver gives us a GL context through EGL (pbuffer or
+    // surfaceless, e.g. Mesa llvmpipe) without any display server
+    if (headless) {
+        SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+    }
+
+    if (SDL_Init(headless ? SDL_INIT_VIDEO : SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
         std::cerr << "Failed to init SDL: " << SDL_GetError() << "\n";
+        if (headless) {
+            explainHeadlessFailure();
+        }
         return -1;
     }
 
@@ -59,10 +605,13 @@ int main(int argc, char* argv[]) {
     SDL_Window* window = SDL_CreateWindow(
         "Video Player",
         1280, 720,
-        SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE
+        headless ? SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN : SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE
     );
     if (!window) {
         std::cerr << "Failed to create SDL window: " << SDL_GetError() << "\n";
+        if (headless) {
+            explainHeadlessFailure();
+        }
         SDL_Quit();
         return -1;
     }
@@ -70,20 +619,43 @@ int main(int argc, char* argv[]) {
     SDL_GLContext glContext = SDL_GL_CreateContext(window);
     if (!glContext) {
         std::cerr << "Failed to create OpenGL context: " << SDL_GetError() << "\n";
+        if (headless) {
+            explainHeadlessFailure();
+        }
         SDL_DestroyWindow(window);
         SDL_Quit();
         return -1;
     }
 
-    if (!gladLoadGLLoader((GLADloadproc)SDL_GL_GetProcAddress)) {
-        std::cerr << "Failed to initialize GLAD\n";
+    // EGL can hand back an older context than asked for; catch that here
+    // rather than at the first missing entry point
+    if (!gladLoadGLLoader((GLADloadproc)SDL_GL_GetProcAddress) ||
+        GLVersion.major < 4 || (GLVersion.major == 4 && GLVersion.minor < 6)) {
+        std::cerr << "Failed to initialize GLAD (need OpenGL 4.6, got "
+            << GLVersion.major << "." << GLVersion.minor << ")\n";
+        if (headless) {
+            explainHeadlessFailure();
+        }
         SDL_GL_DestroyContext(glContext);
         SDL_DestroyWindow(window);
         SDL_Quit();
         return -1;
     }
 
-    SDL_GL_SetSwapInterval(1); // Enable vsync
+    // Linked shader binaries from the last run; read in the background
+    // while the file is opened, before the renderer links every program
+    if (char* prefPath = SDL_GetPrefPath("SDLPlayer", "SDL Player")) {
+        openShaderCache(std::string(prefPath) + "shaders.bin");
+        SDL_free(prefPath);
+    }
+
+    // Vsync paces the loop; the scheduler picks which vblank shows which frame
+    FrameScheduler scheduler;
+    scheduler.setVsync(SDL_GL_SetSwapInterval(1));
+    const SDL_DisplayMode* displayMode = SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(window));
+    if (displayMode) {
+        scheduler.setNominalRefresh(displayMode->refresh_rate);
+    }
 
     // Open video decoder
     VideoDecoder videoDecoder;
@@ -95,12 +667,40 @@ int main(int argc, char* argv[]) {
         return -1;
     }
 
+    // Convert straight to the displayed size when the window is smaller than the video.
+    // The converter belongs to the render thread once that starts.
+    int windowWidth = 0, windowHeight = 0;
+    SDL_GetWindowSizeInPixels(window, &windowWidth, &windowHeight);
+    FrameConverter converter;
+    if (!headless) {
+        converter.setTargetSize(windowWidth, windowHeight); // headless renders at full size
+    }
+
     int videoWidth = videoDecoder.getWidth();
     int videoHeight = videoDecoder.getHeight();
-    VideoRenderer renderer(videoWidth, videoHeight);
+    if (videoDecoder.setupConverter(converter)) {
+        videoWidth = converter.getWidth();
+        videoHeight = converter.getHeight();
+    }
+    VideoRenderer renderer(videoWidth, videoHeight, kTextureRingDepth);
+    renderer.setViewport(windowWidth, windowHeight);
+    renderer.setPboUploadsEnabled(!noPbo);
+
+    if (headless) {
+        int result = runHeadless(videoDecoder, converter, renderer, dumpPath);
+        saveShaderCache();
+        SDL_GL_DestroyContext(glContext);
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+        return result;
+    }
 
-    // Open audio decoder
+    // Open audio decoder, resampling once straight to what the device runs at
+    SDL_AudioSpec deviceSpec = AudioPlayer::queryDeviceSpec();
     AudioDecoder audioDecoder;
+    audioDecoder.setOutputFormat(deviceSpec.freq, deviceSpec.channels, toSampleFormat(deviceSpec.format));
+    audioDecoder.setPassthroughAllowed(!forceResampler);
+    audioDecoder.enableRateAdjustment(systemClock);
     if (!audioDecoder.openFile(videoFile)) {
         std::cerr << "Failed to open audio from file: " << videoFile << "\n";
         SDL_GL_DestroyContext(glContext);
@@ -109,80 +709,133 @@ int main(int argc, char* argv[]) {
         return -1;
     }
 
-    SDL_AudioSpec desiredSpec = {};
-    desiredSpec.freq = audioDecoder.getSampleRate();
-    desiredSpec.format = SDL_AUDIO_S16;
-    desiredSpec.channels = static_cast<Uint8>(audioDecoder.getChannels());
+    const size_t audioFrameBytes = (size_t)audioDecoder.getBytesPerFrame();
+    const double audioBytesPerMs = audioDecoder.getSampleRate() * audioFrameBytes / 1000.0;
+    AudioRingBuffer audioRing((size_t)audioDecoder.getSampleRate() * kAudioRingMs / 1000 * audioFrameBytes);
 
-    SDL_AudioSpec obtainedSpec = {};
+    // SDL pulls from the ring on its own audio thread. The spec is whatever
+    // the decoder settled on, which is the device's own unless it asked for
+    // something we don't produce
+    SDL_AudioSpec audioSpec = {};
+    audioSpec.freq = audioDecoder.getSampleRate();
+    audioSpec.format = toSDLAudioFormat(audioDecoder.getSampleFormat());
+    audioSpec.channels = audioDecoder.getChannels();
 
-    SDL_AudioDeviceID audioDevice = SDL_OpenAudioDevice(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &desiredSpec);
-    if (audioDevice == 0) {
-        std::cerr << "Failed to open audio device: " << SDL_GetError() << "\n";
+    AudioPlayer audioPlayer;
+    if (!audioPlayer.open(audioSpec, &audioRing)) {
+        SDL_GL_DestroyContext(glContext);
+        SDL_DestroyWindow(window);
         SDL_Quit();
         return -1;
     }
 
-    SDL_ResumeAudioDevice(audioDevice);
-
-    std::vector<uint8_t> audioBuffer;
+    // Video follows the audio actually coming out of the speaker
+    MediaClock mediaClock(audioPlayer, audioDecoder.getSampleRate(), audioDecoder.getBytesPerFrame());
+    mediaClock.setMaster(systemClock ? CLOCK_MASTER_SYSTEM : CLOCK_MASTER_AUDIO);
+    IntervalStats avSync;
+
+    // H / F1 toggles the diagnostics overlay
+    PerformanceHud hud;
+    hud.setViewport(windowWidth, windowHeight);
+    hud.setFrameBudget(videoDecoder.getFrameDelay() * 1000.0);
+    StageTiming presentTiming;
+
+    // From here this thread only handles SDL events. The decode thread fills
+    // the frame queue, the audio thread the audio ring, and the render
+    // thread owns GL and presents
+    FrameQueue frameQueue(kFrameQueueDepth);
+    PlayerShared shared;
+
+    SDL_GL_MakeCurrent(window, nullptr);
+    RenderThreadContext renderContext = {
+        window, glContext, renderer, hud, scheduler, converter, frameQueue, shared,
+        presentTiming, audioRing, audioPlayer, audioBytesPerMs, mediaClock, avSync
+    };
+    std::thread renderThread(runRenderThread, std::ref(renderContext));
+    std::thread decodeThread(runDecodeThread, std::ref(videoDecoder), std::ref(frameQueue), std::ref(shared));
+    std::thread audioThread(runAudioThread, std::ref(audioDecoder), std::ref(audioRing),
+        std::ref(audioPlayer), std::ref(mediaClock), std::ref(shared), audioBytesPerMs);
 
     bool running = true;
     SDL_Event event;
 
-    while (running) {
-        Uint32 frameStart = SDL_GetTicks();
-
-        while (SDL_PollEvent(&event)) {
-            if (event.type == SDL_EVENT_QUIT) {
-                running = false;
-            }
+    while (running && SDL_WaitEvent(&event)) {
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        if (event.type == SDL_EVENT_QUIT) {
+            running = false;
+            shared.quit = true;
         }
-
-        // Clear screen
-        glClearColor(0, 0, 0, 1);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        // Video frame
-        AVFrame* frame = videoDecoder.getRGBFrame();
-        if (frame) {
-            int width = videoDecoder.getWidth();
-            int height = videoDecoder.getHeight();
-            int linesize = frame->linesize[0];
-            uint8_t* rgbData = frame->data[0];
-
-            if (linesize == width * 3) {
-                renderer.uploadFrame(rgbData);
-            }
-            else {
-                std::vector<uint8_t> packedData(width * height * 3);
-                for (int y = 0; y < height; ++y) {
-                    memcpy(&packedData[y * width * 3], &rgbData[y * linesize], width * 3);
-                }
-                renderer.uploadFrame(packedData.data());
-            }
+        else if (event.type == SDL_EVENT_WINDOW_EXPOSED) {
+            shared.exposed = true;
         }
-
-        // Audio decode
-        if (audioDecoder.decodeNextFrame(audioBuffer)) {
-            if (!audioBuffer.empty()) {
-                // Lock and append decoded audio to shared buffer
-                std::unique_lock<std::mutex> lock(audioMutex);
-                audioData.insert(audioData.end(), audioBuffer.begin(), audioBuffer.end());
-            }
+        else if (event.type == SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED) {
+            shared.resized = true;
+            shared.windowWidth = event.window.data1;
+            shared.windowHeight = event.window.data2;
+        }
+        else if (event.type == SDL_EVENT_KEY_DOWN && event.key.key == SDLK_F) {
+            shared.cycleFilter = true;
+        }
+        else if (event.type == SDL_EVENT_KEY_DOWN && (event.key.key == SDLK_H || event.key.key == SDLK_F1)) {
+            shared.toggleHud = true;
         }
+        else {
+            continue;
+        }
+        shared.signalled = true;
+        shared.wake.notify_one();
+    }
 
-        renderer.render();
-        SDL_GL_SwapWindow(window);
+    {
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        shared.quit = true;
+        shared.signalled = true;
+    }
+    shared.wake.notify_one();
+    shared.audioWake.notify_one();
+    frameQueue.close();
+    decodeThread.join();
+    audioThread.join();
+    renderThread.join();
+
+    // GL objects are torn down from here
+    SDL_GL_MakeCurrent(window, glContext);
+
+    const StageTiming& upload = renderer.getUploadTiming();
+    std::cout << "Upload: " << upload.count << " frames, avg " << upload.average()
+        << " ms, max " << upload.max_ms << " ms\n";
+    const IntervalStats& intervals = scheduler.getFrameIntervals();
+    const IntervalStats& presentError = scheduler.getPresentError();
+    std::cout << "Frame interval: avg " << intervals.mean_ms << " ms, stddev "
+        << intervals.stddev() << " ms, refresh "
+        << scheduler.getRefreshIntervalNS() / 1e6 << " ms\n";
+    std::cout << "Present vs due: avg " << presentError.mean_ms << " ms, jitter "
+        << presentError.stddev() << " ms, dropped " << scheduler.getDroppedFrames() << "\n";
+    std::cout << "Present (swap): avg " << presentTiming.average() << " ms, max "
+        << presentTiming.max_ms << " ms\n";
+
+    std::cout << "Audio: " << audioPlayer.getUnderruns() << " underruns, "
+        << audioPlayer.getSilenceBytes() / audioBytesPerMs << " ms of silence inserted, device latency "
+        << audioPlayer.getDeviceLatencyMs() << " ms\n";
+    if (shared.audioSync.active) {
+        std::cout << "Audio drift vs system clock: " << shared.audioSync.driftMs << " ms, "
+            << shared.audioSync.correctedMs << " ms corrected in total, last rate "
+            << shared.audioSync.ratePpm << " ppm\n";
+    }
+    if (avSync.count > 0) {
+        std::cout << "A/V sync (video - audio clock): avg " << avSync.mean_ms << " ms, stddev "
+            << avSync.stddev() << " ms over " << avSync.count << " frames\n";
+    }
 
-        Uint32 frameTime = SDL_GetTicks() - frameStart;
-        int delayMs = static_cast<int>(videoDecoder.getFrameDelay() * 1000);
-        if (frameTime < delayMs) {
-            SDL_Delay(delayMs - frameTime);
-        }
+    // Normalised so passthrough and --force-resampler runs compare directly
+    double audioHours = audioDecoder.getOutputSeconds() / 3600.0;
+    if (audioHours > 0.0) {
+        std::cout << "Audio conversion (" << (audioDecoder.isPassthrough() ? "passthrough" : "swresample") << "): "
+            << audioDecoder.getConvertTiming().total_ms / audioHours << " ms CPU per hour of audio\n";
     }
 
-    SDL_CloseAudioDevice(audioDevice);
+    saveShaderCache();
+    audioPlayer.close();
     SDL_GL_DestroyContext(glContext);
     SDL_DestroyWindow(window);
     SDL_Quit();
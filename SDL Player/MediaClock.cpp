@@ -0,0 +1,108 @@
+#include "MediaClock.h"
+#include <cmath>
+
+MediaClock::MediaClock(const AudioPlayer& player, int sample_rate, int bytes_per_frame)
+    : player(player), sample_rate(sample_rate > 0 ? sample_rate : 1),
+    bytes_per_frame(bytes_per_frame > 0 ? bytes_per_frame : 1),
+    master(CLOCK_MASTER_AUDIO), anchored(false), anchor(), pending(), pending_count(0),
+    has_system_origin(false), system_origin_pts(0.0), system_origin_ns(0) {
+}
+
+void MediaClock::setMaster(ClockMaster clock_master) {
+    master = clock_master;
+}
+
+ClockMaster MediaClock::getMaster() const {
+    return master;
+}
+
+void MediaClock::setAnchor(double pts, uint64_t frame) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Anchor update = { pts, frame };
+    if (!anchored) {
+        anchor = update;
+        anchored = true;
+    }
+    else if (pending_count < kMaxPendingAnchors) {
+        pending[pending_count++] = update;
+    }
+    else {
+        pending[kMaxPendingAnchors - 1] = update;
+    }
+}
+
+bool MediaClock::getTime(Uint64 now_ns, double& seconds) {
+    uint64_t heard_bytes = 0;
+    Uint64 at_ns = 0;
+    if (!player.getPlaybackPosition(heard_bytes, at_ns)) {
+        return false;
+    }
+
+    // The snapshot may be newer than the caller's 'now'
+    Uint64 elapsed_ns = now_ns > at_ns ? now_ns - at_ns : 0;
+    if (elapsed_ns > kStaleNS) {
+        return false;
+    }
+    double frame = (double)(heard_bytes / bytes_per_frame) + elapsed_ns * 1e-9 * sample_rate;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!anchored) {
+        return false;
+    }
+    int reached = 0;
+    while (reached < pending_count && frame >= (double)pending[reached].frame) {
+        // Small corrections (rounding, rate adjustment) keep the system
+        // timeline; a real jump (seek, splice) restarts it
+        const Anchor& next = pending[reached++];
+        double predicted = anchor.pts + ((double)next.frame - (double)anchor.frame) / sample_rate;
+        if (std::fabs(next.pts - predicted) > kJumpSeconds) {
+            has_system_origin = false;
+        }
+        anchor = next;
+    }
+    if (reached > 0) {
+        for (int i = reached; i < pending_count; ++i) {
+            pending[i - reached] = pending[i];
+        }
+        pending_count -= reached;
+    }
+    seconds = anchor.pts + (frame - (double)anchor.frame) / sample_rate;
+
+    if (!has_system_origin) {
+        system_origin_pts = seconds;
+        system_origin_ns = now_ns;
+        has_system_origin = true;
+    }
+    return true;
+}
+
+bool MediaClock::getMasterTime(Uint64 now_ns, double& seconds) {
+    if (master == CLOCK_MASTER_AUDIO) {
+        return getTime(now_ns, seconds);
+    }
+
+    double audio_time;
+    getTime(now_ns, audio_time); // sets the origin once audio is going
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!has_system_origin) {
+        return false;
+    }
+    Sint64 elapsed_ns = (Sint64)(now_ns - system_origin_ns);
+    seconds = system_origin_pts + elapsed_ns * 1e-9;
+    return true;
+}
+
+bool MediaClock::getDrift(Uint64 now_ns, double& seconds) {
+    if (master == CLOCK_MASTER_AUDIO) {
+        seconds = 0.0;
+        return true;
+    }
+
+    double audio_time, master_time;
+    if (!getTime(now_ns, audio_time) || !getMasterTime(now_ns, master_time)) {
+        return false;
+    }
+    seconds = audio_time - master_time;
+    return true;
+}
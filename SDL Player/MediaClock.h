@@ -0,0 +1,84 @@
+#ifndef MEDIA_CLOCK_H
+#define MEDIA_CLOCK_H
+
+#include <SDL3/SDL.h>
+#include <cstdint>
+#include <mutex>
+
+#include "AudioPlayer.h"
+
+/// Which clock the rest of playback follows. With the audio clock, video is
+/// scheduled against what's being heard. With the system clock, the
+/// timeline runs on SDL ticks from where audio started, and audio is
+/// stretched by a few ppm to stay on it (see AudioDecoder::setRateAdjustment).
+enum ClockMaster {
+    CLOCK_MASTER_AUDIO,
+    CLOCK_MASTER_SYSTEM
+};
+
+/// Stream time of the audio being heard right now, which video is synced to.
+///
+/// The audio thread anchors the decoder's output: the pts of one output
+/// sample frame, re-anchored whenever the source timestamps jump, and on
+/// every batch while the rate is being adjusted so the stretch shows up in
+/// the clock as it's applied. The
+/// player's callback reports how much of that output has reached the
+/// speaker (handed to SDL, less what's still queued and the device buffer)
+/// and when; between callbacks the position runs on with the wall clock.
+class MediaClock {
+public:
+    MediaClock(const AudioPlayer& player, int sample_rate, int bytes_per_frame);
+
+    void setMaster(ClockMaster master); // before playback starts
+    ClockMaster getMaster() const;
+
+    /// Audio thread: output frame 'frame' (counted from the start of
+    /// playback) has timestamp 'pts'. A new anchor takes over once playback
+    /// reaches it, so samples from before a jump keep their old times. Up to
+    /// kMaxPendingAnchors can wait in the ring; beyond that the newest is
+    /// replaced.
+    void setAnchor(double pts, uint64_t frame);
+
+    /// Stream seconds being heard at 'now_ns' (SDL ticks). False before audio
+    /// has started, and when it has stalled or run out (no real data played
+    /// for a while), so the caller can fall back to its own timing.
+    bool getTime(Uint64 now_ns, double& seconds);
+
+    /// The timeline video follows: getTime() with the audio master; with the
+    /// system master, SDL ticks from the first audio time onwards (still
+    /// valid when audio stalls). False until there is a timeline.
+    bool getMasterTime(Uint64 now_ns, double& seconds);
+
+    /// Audio clock minus master clock in seconds; positive means the audio
+    /// is ahead. Always 0 with the audio master.
+    bool getDrift(Uint64 now_ns, double& seconds);
+
+private:
+    struct Anchor {
+        double pts;
+        uint64_t frame;
+    };
+
+    static const Uint64 kStaleNS = 200 * SDL_NS_PER_MS;
+    static constexpr double kJumpSeconds = 0.5;
+    static const int kMaxPendingAnchors = 16; // batches between decoder and speaker
+
+    const AudioPlayer& player;
+    const int sample_rate;
+    const int bytes_per_frame;
+
+    ClockMaster master;
+
+    std::mutex mutex;
+    bool anchored;
+    Anchor anchor;
+    Anchor pending[kMaxPendingAnchors]; // oldest first
+    int pending_count;
+
+    // System master: pts at 'system_origin_ns'; reset at timestamp jumps
+    bool has_system_origin;
+    double system_origin_pts;
+    Uint64 system_origin_ns;
+};
+
+#endif // MEDIA_CLOCK_H
@@ -0,0 +1,137 @@
+#include "OffscreenTarget.h"
+#include <iostream>
+
+OffscreenTarget::OffscreenTarget(int w, int h)
+	: width(w), height(h)
+{
+	glGenRenderbuffers(1, &colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (!complete) {
+		std::cerr << "Offscreen framebuffer incomplete\n";
+		return;
+	}
+
+	GLsizeiptr size = (GLsizeiptr)width * height * 4;
+	glGenBuffers(kReadbackDepth, pbos);
+	for (int i = 0; i < kReadbackDepth; ++i) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+OffscreenTarget::~OffscreenTarget() {
+	for (int i = 0; i < kReadbackDepth; ++i) {
+		if (fences[i]) glDeleteSync(fences[i]);
+	}
+	glDeleteBuffers(kReadbackDepth, pbos);
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteRenderbuffers(1, &colorBuffer);
+}
+
+bool OffscreenTarget::isComplete() const {
+	return complete;
+}
+
+GLuint OffscreenTarget::getFramebuffer() const {
+	return fbo;
+}
+
+int OffscreenTarget::getWidth() const {
+	return width;
+}
+
+int OffscreenTarget::getHeight() const {
+	return height;
+}
+
+void OffscreenTarget::queueReadback(std::ostream* out) {
+	// Ring full: the oldest frame has to come out before we reuse its buffer
+	if (inFlight == kReadbackDepth) {
+		collectOne(out, true);
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[writeIndex]);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+	// With a pack buffer bound this only queues the copy
+	glReadPixels(0, 0, width, height, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, nullptr);
+	fences[writeIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+	writeIndex = (writeIndex + 1) % kReadbackDepth;
+	++inFlight;
+}
+
+bool OffscreenTarget::collectOne(std::ostream* out, bool wait) {
+	if (inFlight == 0) {
+		return false;
+	}
+
+	GLsync fence = fences[readIndex];
+	GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+		wait ? 1000000000 : 0); // up to 1 s when draining
+	if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED) {
+		if (!wait) {
+			return false;
+		}
+		std::cerr << "Readback fence never signalled, dropping frame\n";
+	}
+
+	ScopedStageTimer timer(readbackTiming);
+
+	glDeleteSync(fence);
+	fences[readIndex] = nullptr;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[readIndex]);
+	const uint8_t* pixels = (const uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+		(GLsizeiptr)width * height * 4, GL_MAP_READ_BIT);
+	if (pixels) {
+		if (out) {
+			// GL rows are bottom-up; write the file top-down
+			size_t stride = (size_t)width * 4;
+			for (int y = height - 1; y >= 0; --y) {
+				out->write((const char*)pixels + y * stride, stride);
+			}
+		}
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	readIndex = (readIndex + 1) % kReadbackDepth;
+	--inFlight;
+	return true;
+}
+
+int OffscreenTarget::collectReadbacks(std::ostream* out) {
+	int collected = 0;
+	while (collectOne(out, false)) {
+		++collected;
+	}
+	return collected;
+}
+
+int OffscreenTarget::finish(std::ostream* out) {
+	int collected = 0;
+	while (collectOne(out, true)) {
+		++collected;
+	}
+	return collected;
+}
+
+const StageTiming& OffscreenTarget::getReadbackTiming() const {
+	return readbackTiming;
+}
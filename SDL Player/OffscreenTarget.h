@@ -0,0 +1,52 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <ostream>
+
+#include "PlaybackStats.h"
+
+// Framebuffer to render into when there is no window to present to
+// (headless batch jobs, regression runs on GPU-less servers with Mesa
+// llvmpipe or an EGL pbuffer context). Frames are read back through a ring
+// of PBOs so glReadPixels returns immediately; each frame is collected a
+// couple of frames later, once its fence has signalled.
+// Needs an EGL-backed GL 4.6 context from SDL's offscreen driver, which a
+// plain Windows install doesn't provide; see the README.
+class OffscreenTarget {
+public:
+	OffscreenTarget(int width, int height);
+	~OffscreenTarget();
+
+	OffscreenTarget(const OffscreenTarget&) = delete;
+	OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+
+	bool isComplete() const;
+	GLuint getFramebuffer() const;
+	int getWidth() const;
+	int getHeight() const;
+
+	void queueReadback(std::ostream* out);       // after the frame has been drawn; out gets any frame forced out early
+	int collectReadbacks(std::ostream* out);     // writes every finished frame, returns how many
+	int finish(std::ostream* out);               // blocks until all queued frames are written
+
+	const StageTiming& getReadbackTiming() const; // map + write per collected frame
+
+private:
+	bool collectOne(std::ostream* out, bool wait);
+
+	static const int kReadbackDepth = 3;
+
+	int width, height;
+	GLuint fbo = 0;
+	GLuint colorBuffer = 0;
+	bool complete = false;
+
+	GLuint pbos[kReadbackDepth] = {};
+	GLsync fences[kReadbackDepth] = {};
+	int writeIndex = 0; // next slot to read into
+	int readIndex = 0;  // oldest slot still in flight
+	int inFlight = 0;
+
+	StageTiming readbackTiming;
+};
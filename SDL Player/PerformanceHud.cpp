@@ -0,0 +1,343 @@
+#include "PerformanceHud.h"
+#include "ShaderProgram.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+
+static const char* hudVertexShaderSource = R"(
+#version 460 core
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec4 aColor;
+
+out vec2 TexCoord;
+out vec4 Color;
+
+uniform vec2 uViewport;
+
+void main() {
+    vec2 ndc = aPos / uViewport * 2.0 - 1.0;
+    gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+    TexCoord = aTexCoord;
+    Color = aColor;
+}
+)";
+
+static const char* hudFragmentShaderSource = R"(
+#version 460 core
+in vec2 TexCoord;
+in vec4 Color;
+out vec4 FragColor;
+
+uniform sampler2D uAtlas;
+
+void main() {
+    FragColor = vec4(Color.rgb, Color.a * texture(uAtlas, TexCoord).r);
+}
+)";
+
+// 5x7 glyphs, one byte per row, bit 4 = leftmost column. Lower case is
+// drawn as upper case; anything missing comes out blank.
+struct Glyph {
+	char ch;
+	uint8_t rows[7];
+};
+
+static const Glyph kGlyphs[] = {
+	{ '0', { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E } },
+	{ '1', { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+	{ '2', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F } },
+	{ '3', { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E } },
+	{ '4', { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 } },
+	{ '5', { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E } },
+	{ '6', { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E } },
+	{ '7', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 } },
+	{ '8', { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E } },
+	{ '9', { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C } },
+	{ 'A', { 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+	{ 'B', { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E } },
+	{ 'C', { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E } },
+	{ 'D', { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C } },
+	{ 'E', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F } },
+	{ 'F', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 } },
+	{ 'G', { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F } },
+	{ 'H', { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+	{ 'I', { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+	{ 'J', { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C } },
+	{ 'K', { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 } },
+	{ 'L', { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F } },
+	{ 'M', { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 } },
+	{ 'N', { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 } },
+	{ 'O', { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+	{ 'P', { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 } },
+	{ 'Q', { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D } },
+	{ 'R', { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 } },
+	{ 'S', { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E } },
+	{ 'T', { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 } },
+	{ 'U', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+	{ 'V', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 } },
+	{ 'W', { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A } },
+	{ 'X', { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 } },
+	{ 'Y', { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 } },
+	{ 'Z', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F } },
+	{ '.', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C } },
+	{ ',', { 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 } },
+	{ ':', { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 } },
+	{ '/', { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 } },
+	{ '%', { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 } },
+	{ '-', { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 } },
+	{ '+', { 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 } },
+	{ '=', { 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00 } },
+	{ '_', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F } },
+	{ '(', { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 } },
+	{ ')', { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 } },
+	{ '[', { 0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E } },
+	{ ']', { 0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E } },
+	{ '<', { 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 } },
+	{ '>', { 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 } },
+	{ '|', { 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 } },
+};
+
+// Atlas layout: printable ASCII (32..126) in a 16x6 grid of 6x8 cells,
+// glyph in the top-left 5x7 so cells can be placed edge to edge. Cell 127
+// is solid and used for every untextured rectangle.
+static const int kCellWidth = 6;
+static const int kCellHeight = 8;
+static const int kAtlasColumns = 16;
+static const int kAtlasRows = 6;
+static const int kAtlasWidth = kCellWidth * kAtlasColumns;
+static const int kAtlasHeight = kCellHeight * kAtlasRows;
+static const int kSolidCell = 127 - 32;
+
+// Screen layout, in window pixels
+static const int kGlyphScale = 2;
+static const int kMargin = 8;
+static const int kPadding = 6;
+static const int kLineHeight = kCellHeight * kGlyphScale + 2;
+static const int kGraphBarWidth = 2;
+static const int kGraphHeight = 64;
+
+static void cellOrigin(int cell, int& x, int& y) {
+	x = (cell % kAtlasColumns) * kCellWidth;
+	y = (cell / kAtlasColumns) * kCellHeight;
+}
+
+PerformanceHud::PerformanceHud() {
+	initGLObjects();
+	vertices.reserve(4096);
+}
+
+PerformanceHud::~PerformanceHud() {
+	glDeleteProgram(program);
+	glDeleteTextures(1, &atlas);
+	glDeleteBuffers(1, &VBO);
+	glDeleteVertexArrays(1, &VAO);
+}
+
+void PerformanceHud::initGLObjects() {
+	program = linkProgram(hudVertexShaderSource, hudFragmentShaderSource);
+	viewportLoc = glGetUniformLocation(program, "uViewport");
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "uAtlas"), 0);
+
+	// Rasterise the font into a single-channel coverage texture
+	std::vector<uint8_t> pixels(kAtlasWidth * kAtlasHeight, 0);
+	for (const Glyph& glyph : kGlyphs) {
+		int x0, y0;
+		cellOrigin(glyph.ch - 32, x0, y0);
+		for (int row = 0; row < 7; ++row) {
+			for (int col = 0; col < 5; ++col) {
+				if (glyph.rows[row] & (0x10 >> col)) {
+					pixels[(y0 + row) * kAtlasWidth + x0 + col] = 255;
+				}
+			}
+		}
+	}
+	int sx, sy;
+	cellOrigin(kSolidCell, sx, sy);
+	for (int row = 0; row < kCellHeight; ++row) {
+		std::fill_n(&pixels[(sy + row) * kAtlasWidth + sx], kCellWidth, (uint8_t)255);
+	}
+
+	// The renderer may have left a PBO bound or a row length set
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	glGenTextures(1, &atlas);
+	glBindTexture(GL_TEXTURE_2D, atlas);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_R8, kAtlasWidth, kAtlasHeight);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, kAtlasWidth, kAtlasHeight, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, x));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, u));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, r));
+	glEnableVertexAttribArray(2);
+	glBindVertexArray(0);
+}
+
+void PerformanceHud::setVisible(bool v) {
+	visible = v;
+}
+
+bool PerformanceHud::isVisible() const {
+	return visible;
+}
+
+void PerformanceHud::setViewport(int width, int height) {
+	viewWidth = width;
+	viewHeight = height;
+}
+
+void PerformanceHud::addFrameTime(double ms) {
+	frameTimes[frameTimeIndex] = ms;
+	frameTimeIndex = (frameTimeIndex + 1) % kGraphSamples;
+	if (frameTimeCount < kGraphSamples) {
+		++frameTimeCount;
+	}
+}
+
+void PerformanceHud::setFrameBudget(double ms) {
+	if (ms > 0.0) {
+		frameBudget = ms;
+	}
+}
+
+void PerformanceHud::clearText() {
+	text.clear();
+	lineCount = 0;
+	longestLine = 0;
+}
+
+void PerformanceHud::addLine(const char* format, ...) {
+	char line[256];
+	va_list args;
+	va_start(args, format);
+	int len = vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	if (len < 0) {
+		return;
+	}
+
+	text.append(line);
+	text.push_back('\n');
+	++lineCount;
+	longestLine = std::max(longestLine, std::min((size_t)len, sizeof(line) - 1));
+}
+
+void PerformanceHud::addQuad(float x, float y, float w, float h, float u0, float v0, float u1, float v1, uint32_t rgba) {
+	uint8_t r = (uint8_t)(rgba >> 24), g = (uint8_t)(rgba >> 16), b = (uint8_t)(rgba >> 8), a = (uint8_t)rgba;
+	Vertex tl = { x, y, u0, v0, r, g, b, a };
+	Vertex tr = { x + w, y, u1, v0, r, g, b, a };
+	Vertex bl = { x, y + h, u0, v1, r, g, b, a };
+	Vertex br = { x + w, y + h, u1, v1, r, g, b, a };
+	vertices.push_back(tl);
+	vertices.push_back(bl);
+	vertices.push_back(tr);
+	vertices.push_back(tr);
+	vertices.push_back(bl);
+	vertices.push_back(br);
+}
+
+void PerformanceHud::addSolid(float x, float y, float w, float h, uint32_t rgba) {
+	// Sample the middle of the solid cell so filtering can't reach a neighbour
+	int sx, sy;
+	cellOrigin(kSolidCell, sx, sy);
+	float u = (sx + kCellWidth * 0.5f) / kAtlasWidth;
+	float v = (sy + kCellHeight * 0.5f) / kAtlasHeight;
+	addQuad(x, y, w, h, u, v, u, v, rgba);
+}
+
+void PerformanceHud::addText(float x, float y, const char* line, size_t length, uint32_t rgba) {
+	const float w = (float)(kCellWidth * kGlyphScale);
+	const float h = (float)(kCellHeight * kGlyphScale);
+	for (size_t i = 0; i < length; ++i) {
+		char c = line[i];
+		if (c >= 'a' && c <= 'z') {
+			c = c - 'a' + 'A';
+		}
+		if (c > ' ' && c < 127) {
+			int cx, cy;
+			cellOrigin(c - 32, cx, cy);
+			addQuad(x, y, w, h,
+				(float)cx / kAtlasWidth, (float)cy / kAtlasHeight,
+				(float)(cx + kCellWidth) / kAtlasWidth, (float)(cy + kCellHeight) / kAtlasHeight,
+				rgba);
+		}
+		x += w;
+	}
+}
+
+void PerformanceHud::draw() {
+	if (!visible || viewWidth <= 0 || viewHeight <= 0) {
+		return;
+	}
+	ScopedStageTimer timer(drawTiming);
+
+	const float graphWidth = (float)(kGraphSamples * kGraphBarWidth);
+	const float textWidth = (float)(longestLine * kCellWidth * kGlyphScale);
+	const float panelWidth = std::max(textWidth, graphWidth) + 2 * kPadding;
+	const float panelHeight = (float)(kPadding + lineCount * kLineHeight + kPadding + kGraphHeight + kPadding);
+
+	vertices.clear();
+	addSolid((float)kMargin, (float)kMargin, panelWidth, panelHeight, 0x000000B0);
+
+	// Text
+	float x = (float)(kMargin + kPadding);
+	float y = (float)(kMargin + kPadding);
+	size_t start = 0;
+	while (start < text.size()) {
+		size_t end = text.find('\n', start);
+		if (end == std::string::npos) end = text.size();
+		addText(x, y, text.data() + start, end - start, 0xFFFFFFFF);
+		y += kLineHeight;
+		start = end + 1;
+	}
+
+	// Frame-time graph, oldest on the left; full height is three budgets
+	y += kPadding;
+	const float bottom = y + kGraphHeight;
+	const double graphRange = frameBudget * 3.0;
+	addSolid(x, y, graphWidth, (float)kGraphHeight, 0x30303080);
+	for (int i = 0; i < frameTimeCount; ++i) {
+		int index = (frameTimeIndex - frameTimeCount + i + kGraphSamples) % kGraphSamples;
+		double ms = frameTimes[index];
+		float barHeight = (float)(std::min(ms / graphRange, 1.0) * kGraphHeight);
+		uint32_t color = ms <= frameBudget * 1.5 ? 0x40E040FF : 0xFF4040FF;
+		addSolid(x + (float)(i * kGraphBarWidth), bottom - barHeight, (float)(kGraphBarWidth - 1), barHeight, color);
+	}
+	float budgetY = bottom - (float)(frameBudget / graphRange * kGraphHeight);
+	addSolid(x, budgetY, graphWidth, 1.0f, 0xFFE040FF);
+
+	// One upload, one draw
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STREAM_DRAW);
+
+	glViewport(0, 0, viewWidth, viewHeight);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glUseProgram(program);
+	glUniform2f(viewportLoc, (float)viewWidth, (float)viewHeight);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, atlas);
+	glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertices.size());
+	glDisable(GL_BLEND);
+}
+
+const StageTiming& PerformanceHud::getDrawTiming() const {
+	return drawTiming;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "PlaybackStats.h"
+
+// On-screen diagnostics: a few lines of text plus a frame-time graph,
+// composited over the video in the same pass. Everything (background,
+// glyphs, graph bars) comes out of one small atlas texture and goes out as
+// a single draw call, so drawing the HUD barely moves the numbers it shows.
+class PerformanceHud {
+public:
+	PerformanceHud();
+	~PerformanceHud();
+
+	void setVisible(bool visible);
+	bool isVisible() const;
+	void setViewport(int width, int height); // window size in pixels
+
+	// Graph input: one sample per presented frame, and the interval a
+	// smooth stream would show (drawn as a reference line)
+	void addFrameTime(double ms);
+	void setFrameBudget(double ms);
+
+	// Text is rebuilt by the caller before each draw; printf-style
+	void clearText();
+	void addLine(const char* format, ...);
+
+	void draw(); // into whatever framebuffer is bound; no-op when hidden
+
+	const StageTiming& getDrawTiming() const; // the HUD's own cost
+
+private:
+	struct Vertex {
+		float x, y; // pixels, top-left origin
+		float u, v;
+		uint8_t r, g, b, a;
+	};
+
+	void initGLObjects();
+	void addQuad(float x, float y, float w, float h, float u0, float v0, float u1, float v1, uint32_t rgba);
+	void addSolid(float x, float y, float w, float h, uint32_t rgba);
+	void addText(float x, float y, const char* line, size_t length, uint32_t rgba);
+
+	static const int kGraphSamples = 120;
+
+	bool visible = false;
+	int viewWidth = 0, viewHeight = 0;
+
+	std::string text;
+	int lineCount = 0;
+	size_t longestLine = 0;
+
+	double frameTimes[kGraphSamples] = {};
+	int frameTimeIndex = 0;
+	int frameTimeCount = 0;
+	double frameBudget = 1000.0 / 60.0;
+
+	std::vector<Vertex> vertices; // rebuilt every draw, capacity kept
+	GLuint program = 0;
+	GLint viewportLoc = -1;
+	GLuint VAO = 0, VBO = 0;
+	GLuint atlas = 0;
+	StageTiming drawTiming;
+};
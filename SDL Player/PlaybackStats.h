@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+// Running min/avg/max of how long one pipeline stage takes
+struct StageTiming {
+	uint64_t count = 0;
+	double last_ms = 0.0;
+	double total_ms = 0.0;
+	double max_ms = 0.0;
+
+	void add(double ms) {
+		++count;
+		last_ms = ms;
+		total_ms += ms;
+		if (ms > max_ms) max_ms = ms;
+	}
+
+	double average() const {
+		return count ? total_ms / count : 0.0;
+	}
+
+	void reset() {
+		*this = StageTiming();
+	}
+};
+
+// Adds the scope's duration to a StageTiming when it ends
+class ScopedStageTimer {
+public:
+	explicit ScopedStageTimer(StageTiming& timing)
+		: timing(timing), start(std::chrono::steady_clock::now()) {}
+
+	~ScopedStageTimer() {
+		timing.add(std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - start).count());
+	}
+
+private:
+	StageTiming& timing;
+	std::chrono::steady_clock::time_point start;
+};
+
+// Mean and spread of a series of intervals (Welford's method), e.g. the
+// time between presented frames
+struct IntervalStats {
+	uint64_t count = 0;
+	double mean_ms = 0.0;
+	double m2 = 0.0;
+	double last_ms = 0.0;
+
+	void add(double ms) {
+		++count;
+		last_ms = ms;
+		double delta = ms - mean_ms;
+		mean_ms += delta / count;
+		m2 += delta * (ms - mean_ms);
+	}
+
+	double stddev() const {
+		return count > 1 ? std::sqrt(m2 / (count - 1)) : 0.0;
+	}
+
+	void reset() {
+		*this = IntervalStats();
+	}
+};
@@ -0,0 +1,71 @@
+#include "ScalerCache.h"
+#include <iostream>
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+}
+
+ScalerCache::ScalerCache() {}
+
+ScalerCache::~ScalerCache() {
+	clear();
+}
+
+SwsContext* ScalerCache::get(int src_w, int src_h, AVPixelFormat src_fmt,
+	int dst_w, int dst_h, AVPixelFormat dst_fmt, int flags,
+	const ColorMatrix& colors) {
+	++use_counter;
+
+	for (int i = 0; i < count; ++i) {
+		Entry& e = entries[i];
+		if (e.src_w == src_w && e.src_h == src_h && e.src_fmt == src_fmt &&
+			e.dst_w == dst_w && e.dst_h == dst_h && e.dst_fmt == dst_fmt &&
+			e.flags == flags && e.colors == &colors) {
+			e.last_used = use_counter;
+			return e.ctx;
+		}
+	}
+
+	SwsContext* ctx = sws_getContext(
+		src_w, src_h, src_fmt,
+		dst_w, dst_h, dst_fmt,
+		flags, nullptr, nullptr, nullptr
+	);
+	if (!ctx) {
+		std::cerr << "Failed to create scaler for " << src_w << "x" << src_h
+			<< " " << av_get_pix_fmt_name(src_fmt) << "\n";
+		return nullptr;
+	}
+
+	// Hand swscale the exact coefficients instead of its BT.601 default;
+	// output is always full-range RGB
+	sws_setColorspaceDetails(ctx,
+		colors.sws, colors.full_range ? 1 : 0,
+		sws_getCoefficients(SWS_CS_DEFAULT), 1,
+		0, 1 << 16, 1 << 16);
+
+	// Evict the least recently used entry once the cache is full
+	int slot = count;
+	if (count == kMaxEntries) {
+		slot = 0;
+		for (int i = 1; i < count; ++i) {
+			if (entries[i].last_used < entries[slot].last_used) {
+				slot = i;
+			}
+		}
+		sws_freeContext(entries[slot].ctx);
+	}
+	else {
+		++count;
+	}
+
+	entries[slot] = { src_w, src_h, src_fmt, dst_w, dst_h, dst_fmt, flags, &colors, ctx, use_counter };
+	return ctx;
+}
+
+void ScalerCache::clear() {
+	for (int i = 0; i < count; ++i) {
+		sws_freeContext(entries[i].ctx);
+	}
+	count = 0;
+}
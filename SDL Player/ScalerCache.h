@@ -0,0 +1,47 @@
+#pragma once
+
+extern "C" {
+#include <libswscale/swscale.h>
+}
+
+#include <cstdint>
+
+#include "ColorMatrix.h"
+
+// Small LRU cache of swscale contexts keyed by their full conversion
+// parameters, so switching back and forth between stream resolutions
+// (adaptive streams, spliced captures) doesn't rebuild filters every time.
+class ScalerCache {
+public:
+	ScalerCache();
+	~ScalerCache();
+
+	ScalerCache(const ScalerCache&) = delete;
+	ScalerCache& operator=(const ScalerCache&) = delete;
+
+	// returns a context for the given conversion, owned by the cache;
+	// 'colors' selects the YCbCr matrix and range the source is decoded with
+	SwsContext* get(int src_w, int src_h, AVPixelFormat src_fmt,
+		int dst_w, int dst_h, AVPixelFormat dst_fmt, int flags,
+		const ColorMatrix& colors);
+
+	void clear();
+
+private:
+	struct Entry {
+		int src_w, src_h;
+		AVPixelFormat src_fmt;
+		int dst_w, dst_h;
+		AVPixelFormat dst_fmt;
+		int flags;
+		const ColorMatrix* colors;
+		SwsContext* ctx;
+		uint64_t last_used;
+	};
+
+	static const int kMaxEntries = 4;
+
+	Entry entries[kMaxEntries];
+	int count = 0;
+	uint64_t use_counter = 0;
+};
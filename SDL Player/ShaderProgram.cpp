@@ -0,0 +1,235 @@
+#include "ShaderProgram.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+struct ProgramBinary {
+	GLenum format = 0;
+	std::vector<char> data;
+};
+
+typedef std::unordered_map<uint64_t, ProgramBinary> ProgramBinaryMap;
+
+// File layout: header, then (key, format, length, bytes) per program.
+// Anything that doesn't add up is treated as no cache at all.
+static const uint32_t kCacheMagic = 0x48535053; // "SPSH"
+static const uint32_t kCacheVersion = 1;
+static const uint32_t kMaxBinarySize = 16 * 1024 * 1024;
+
+struct ShaderCache {
+	bool enabled = false;
+	bool dirty = false;
+	std::string path;
+	uint64_t driver = 0; // hash of the driver identification strings
+	std::future<ProgramBinaryMap> loading;
+	ProgramBinaryMap entries;
+};
+
+static ShaderCache cache;
+
+// FNV-1a; the terminator is hashed too so "ab"+"c" != "a"+"bc"
+static uint64_t hashString(uint64_t hash, const char* str) {
+	if (!str) {
+		return hash;
+	}
+	size_t len = strlen(str) + 1;
+	for (size_t i = 0; i < len; ++i) {
+		hash ^= (uint8_t)str[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+template <typename T>
+static bool readValue(std::istream& in, T& value) {
+	return (bool)in.read((char*)&value, sizeof(value));
+}
+
+template <typename T>
+static void writeValue(std::ostream& out, const T& value) {
+	out.write((const char*)&value, sizeof(value));
+}
+
+static ProgramBinaryMap readCacheFile(std::string path, uint64_t driver) {
+	ProgramBinaryMap entries;
+	std::ifstream in(path, std::ios::binary);
+	uint32_t magic = 0, version = 0, count = 0;
+	uint64_t file_driver = 0;
+	if (!in || !readValue(in, magic) || !readValue(in, version) ||
+		!readValue(in, file_driver) || !readValue(in, count)) {
+		return entries;
+	}
+	// A driver update invalidates every binary in the file
+	if (magic != kCacheMagic || version != kCacheVersion || file_driver != driver) {
+		return entries;
+	}
+
+	for (uint32_t i = 0; i < count; ++i) {
+		uint64_t key = 0;
+		uint32_t format = 0, length = 0;
+		if (!readValue(in, key) || !readValue(in, format) || !readValue(in, length) ||
+			length == 0 || length > kMaxBinarySize) {
+			entries.clear();
+			break;
+		}
+		ProgramBinary& entry = entries[key];
+		entry.format = format;
+		entry.data.resize(length);
+		if (!in.read(entry.data.data(), length)) {
+			entries.clear();
+			break;
+		}
+	}
+	return entries;
+}
+
+static void waitForCacheFile() {
+	if (cache.loading.valid()) {
+		cache.entries = cache.loading.get();
+	}
+}
+
+static GLuint loadCachedProgram(uint64_t key) {
+	waitForCacheFile();
+	auto it = cache.entries.find(key);
+	if (it == cache.entries.end()) {
+		return 0;
+	}
+
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, it->second.format, it->second.data.data(), (GLsizei)it->second.data.size());
+
+	int success;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success) {
+		// Rejected (e.g. the driver changed under the same version string);
+		// fall back to source and replace the entry
+		glDeleteProgram(program);
+		cache.entries.erase(it);
+		cache.dirty = true;
+		return 0;
+	}
+	return program;
+}
+
+static void storeProgram(uint64_t key, GLuint program) {
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0 || (uint32_t)length > kMaxBinarySize) {
+		return;
+	}
+
+	ProgramBinary entry;
+	entry.data.resize(length);
+	GLsizei written = 0;
+	glGetProgramBinary(program, length, &written, &entry.format, entry.data.data());
+	if (written <= 0) {
+		return;
+	}
+	entry.data.resize(written);
+	cache.entries[key] = std::move(entry);
+	cache.dirty = true;
+}
+
+static GLuint compileShader(GLenum type, const char* src) {
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &src, nullptr);
+	glCompileShader(shader);
+
+	int success;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+	if (!success) {
+		char log[512];
+		glGetShaderInfoLog(shader, 512, nullptr, log);
+		std::cerr << "Shader compile error:\n" << log << "\n";
+	}
+	return shader;
+}
+
+GLuint linkProgram(const char* vsSrc, const char* fsSrc) {
+	uint64_t key = hashString(hashString(cache.driver, vsSrc), fsSrc);
+	if (cache.enabled) {
+		if (GLuint program = loadCachedProgram(key)) {
+			return program;
+		}
+	}
+
+	GLuint vs = compileShader(GL_VERTEX_SHADER, vsSrc);
+	GLuint fs = compileShader(GL_FRAGMENT_SHADER, fsSrc);
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vs);
+	glAttachShader(program, fs);
+	if (cache.enabled) {
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glLinkProgram(program);
+	glDeleteShader(vs);
+	glDeleteShader(fs);
+
+	int success;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success) {
+		char log[512];
+		glGetProgramInfoLog(program, 512, nullptr, log);
+		std::cerr << "Shader link error:\n" << log << "\n";
+	}
+	else if (cache.enabled) {
+		storeProgram(key, program);
+	}
+	return program;
+}
+
+void openShaderCache(const std::string& path) {
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if (formats <= 0) {
+		std::cout << "Driver exposes no program binary formats, shaders are compiled every launch\n";
+		return;
+	}
+
+	uint64_t driver = 14695981039346656037ull;
+	driver = hashString(driver, (const char*)glGetString(GL_VENDOR));
+	driver = hashString(driver, (const char*)glGetString(GL_RENDERER));
+	driver = hashString(driver, (const char*)glGetString(GL_VERSION));
+	driver = hashString(driver, (const char*)glGetString(GL_SHADING_LANGUAGE_VERSION));
+
+	cache.enabled = true;
+	cache.dirty = false;
+	cache.path = path;
+	cache.driver = driver;
+	cache.entries.clear();
+	cache.loading = std::async(std::launch::async, readCacheFile, path, driver);
+}
+
+void saveShaderCache() {
+	if (!cache.enabled) {
+		return;
+	}
+	waitForCacheFile();
+	if (!cache.dirty) {
+		return;
+	}
+
+	// A short write leaves a file readCacheFile() rejects, so no temp file
+	std::ofstream out(cache.path, std::ios::binary | std::ios::trunc);
+	if (!out) {
+		std::cerr << "Failed to write shader cache: " << cache.path << "\n";
+		return;
+	}
+	writeValue(out, kCacheMagic);
+	writeValue(out, kCacheVersion);
+	writeValue(out, cache.driver);
+	writeValue(out, (uint32_t)cache.entries.size());
+	for (const auto& entry : cache.entries) {
+		writeValue(out, entry.first);
+		writeValue(out, (uint32_t)entry.second.format);
+		writeValue(out, (uint32_t)entry.second.data.size());
+		out.write(entry.second.data.data(), entry.second.data.size());
+	}
+	cache.dirty = false;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+
+// Compiles and links a vertex + fragment shader pair. Errors are logged;
+// the returned program is still valid to delete. With a shader cache open,
+// programs linked on an earlier run are restored from their driver binary.
+GLuint linkProgram(const char* vsSrc, const char* fsSrc);
+
+// On-disk cache of linked program binaries, keyed by the driver's vendor,
+// renderer and version strings plus a hash of the shader sources. Call
+// openShaderCache() once the GL context is current; the file is read on a
+// background thread while the rest of startup carries on. Programs linked
+// from source this run are written back by saveShaderCache().
+void openShaderCache(const std::string& path);
+void saveShaderCache();
@@ -1,4 +1,5 @@
 #include "VideoDecoder.h"
+#include <chrono>
 #include <iostream>
 
 VideoDecoder::VideoDecoder() {}
@@ -6,11 +7,9 @@ VideoDecoder::VideoDecoder() {}
 VideoDecoder::~VideoDecoder() {
 	av_packet_free(&packet);
 	av_frame_free(&yuv_frame);
-	av_frame_free(&rgb_frame);
+	av_frame_free(&filtered_frame);
 	avcodec_free_context(&codec_ctx);
 	avformat_close_input(&fmt_ctx);
-	sws_freeContext(sws_ctx);
-	av_free(rgb_buffer);
 }
 
 bool VideoDecoder::openFile(const std::string& filepath) {
@@ -63,44 +62,35 @@ bool VideoDecoder::openFile(const std::string& filepath) {
 
 	packet = av_packet_alloc();
 	yuv_frame = av_frame_alloc();
-	rgb_frame = av_frame_alloc();
-
-	setupSwsContext();
+	filtered_frame = av_frame_alloc();
 
 	return true;
 }
 
-void VideoDecoder::setupSwsContext() {
-	if (sws_ctx) {
-		sws_freeContext(sws_ctx);
-		sws_ctx = nullptr;
-	}
-	if (rgb_buffer) {
-		av_free(rgb_buffer);
-		rgb_buffer = nullptr;
+bool VideoDecoder::setupConverter(FrameConverter& converter) const {
+	if (!codec_ctx || codec_ctx->pix_fmt == AV_PIX_FMT_NONE) {
+		return false;
 	}
-
-	int width = codec_ctx->width;
-	int height = codec_ctx->height;
-	AVPixelFormat src_fmt = codec_ctx->pix_fmt;
-	AVPixelFormat dst_fmt = AV_PIX_FMT_RGB24;
-
-	sws_ctx = sws_getContext(
-		width, height, src_fmt,
-		width, height, dst_fmt,
-		SWS_BILINEAR, nullptr, nullptr, nullptr
-	);
-
-	int num_bytes = av_image_get_buffer_size(dst_fmt, width, height, 1);
-	rgb_buffer = (uint8_t*)av_malloc(num_bytes * sizeof(uint8_t));
-	av_image_fill_arrays(
-		rgb_frame->data, rgb_frame->linesize,
-		rgb_buffer, dst_fmt,
-		width, height, 1
-	);
+	return converter.setup(codec_ctx->width, codec_ctx->height, codec_ctx->pix_fmt,
+		colorMatrixFor(codec_ctx->colorspace, codec_ctx->color_range, codec_ctx->height),
+		codec_ctx->sample_aspect_ratio);
 }
 
 bool VideoDecoder::decodeNextFrame() {
+	// Time spent in the demuxer is split out of the decode figure
+	double demux_ms = 0.0;
+	auto start = std::chrono::steady_clock::now();
+	bool got_frame = receiveFrame(demux_ms);
+	double total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	if (got_frame) {
+		demux_timing.add(demux_ms);
+		decode_timing.add(total_ms - demux_ms);
+	}
+	return got_frame;
+}
+
+bool VideoDecoder::receiveFrame(double& demux_ms) {
 	// Loop until a decoded frame is ready or no more packets
 	while (true) {
 		// Try to receive a frame already buffered in the decoder
@@ -113,7 +103,10 @@ bool VideoDecoder::decodeNextFrame() {
 			// Need to send more packets to decoder
 
 			// Read the next packet from the stream
-			if (av_read_frame(fmt_ctx, packet) < 0) {
+			auto read_start = std::chrono::steady_clock::now();
+			int read_ret = av_read_frame(fmt_ctx, packet);
+			demux_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - read_start).count();
+			if (read_ret < 0) {
 				// No more packets available (end of file)
 				// Flush decoder by sending a null packet
 				avcodec_send_packet(codec_ctx, nullptr);
@@ -158,20 +151,77 @@ bool VideoDecoder::decodeNextFrame() {
 	}
 }
 
-AVFrame* VideoDecoder::getRGBFrame() {
-	if (!decodeNextFrame()) {
-		return nullptr;
+bool VideoDecoder::nextSourceFrame() {
+	AVRational time_base = fmt_ctx->streams[video_stream_index]->time_base;
+
+	while (true) {
+		// Drain anything the deinterlacer already has ready
+		if (deinterlacer.isActive()) {
+			int ret = deinterlacer.pull(filtered_frame);
+			if (ret == 0) {
+				src_frame = filtered_frame;
+				return true;
+			}
+			if (ret != AVERROR(EAGAIN)) {
+				return false;
+			}
+		}
+
+		if (!decodeNextFrame()) {
+			// bwdif holds one frame back; flush once so it comes out
+			if (deinterlacer.isActive() && !filter_flushed) {
+				deinterlacer.flush();
+				filter_flushed = true;
+				continue;
+			}
+			return false;
+		}
+
+		// Once engaged the filter stays in, it passes progressive frames through
+		bool interlaced = (yuv_frame->flags & AV_FRAME_FLAG_INTERLACED) != 0;
+		if (deinterlace_enabled && (interlaced || deinterlacer.isActive())) {
+			if (deinterlacer.push(yuv_frame, time_base)) {
+				continue;
+			}
+			std::cerr << "Deinterlacing failed, showing frames as decoded\n";
+			deinterlace_enabled = false;
+		}
+
+		src_frame = yuv_frame;
+		return true;
 	}
+}
 
-	// Convert YUV -> RGB
-	sws_scale(
-		sws_ctx,
-		yuv_frame->data, yuv_frame->linesize,
-		0, codec_ctx->height,
-		rgb_frame->data, rgb_frame->linesize
-	);
+bool VideoDecoder::decodeSourceFrame() {
+	if (!nextSourceFrame()) {
+		return false;
+	}
 
-	return rgb_frame;
+	// Timestamps can be missing on some streams; carry on at the nominal rate
+	int64_t ts = src_frame->best_effort_timestamp;
+	if (ts == AV_NOPTS_VALUE) {
+		ts = src_frame->pts;
+	}
+	if (ts != AV_NOPTS_VALUE) {
+		frame_pts = ts * av_q2d(fmt_ctx->streams[video_stream_index]->time_base);
+	}
+	else {
+		frame_pts += frame_delay;
+	}
+
+	return true;
+}
+
+void VideoDecoder::setDeinterlaceEnabled(bool enabled) {
+	deinterlace_enabled = enabled;
+}
+
+double VideoDecoder::getFramePts() const {
+	return frame_pts;
+}
+
+AVFrame* VideoDecoder::getSourceFrame() {
+	return src_frame;
 }
 
 int VideoDecoder::getWidth() const {
@@ -184,4 +234,16 @@ int VideoDecoder::getHeight() const {
 
 double VideoDecoder::getFrameDelay() const {
 	return frame_delay;
-}
\ No newline at end of file
+}
+
+const StageTiming& VideoDecoder::getDemuxTiming() const {
+	return demux_timing;
+}
+
+const StageTiming& VideoDecoder::getDecodeTiming() const {
+	return decode_timing;
+}
+
+const Deinterlacer& VideoDecoder::getDeinterlacer() const {
+	return deinterlacer;
+}
@@ -3,37 +3,68 @@
 extern "C" {
 #include <libavformat/avformat.h>
 #include <libavcodec/avcodec.h>
-#include <libswscale/swscale.h>
-#include <libavutil/imgutils.h>
 }
 
 #include <string>
 
+#include "Deinterlacer.h"
+#include "FrameConverter.h"
+#include "PlaybackStats.h"
+
 class VideoDecoder {
 public:
 	VideoDecoder();
 	~VideoDecoder();
 
 	bool openFile(const std::string& filepath); // gets our file from path
-	AVFrame* getRGBFrame(); // gives us a rgb-converted frame
 
-	int getWidth() const;
+	// Readies the next frame and its pts; conversion happens elsewhere, in a
+	// FrameConverter. The frame stays valid until the next decode; its
+	// references may be moved out.
+	bool decodeSourceFrame();
+	AVFrame* getSourceFrame();
+
+	// Sets 'converter' up from the stream parameters so its output size is
+	// known before the first frame. False if the codec only reports its
+	// pixel format once decoding starts; prepare() handles it then.
+	bool setupConverter(FrameConverter& converter) const;
+
+	// Deinterlacing engages automatically on frames flagged as interlaced
+	void setDeinterlaceEnabled(bool enabled);
+
+	double getFramePts() const; // presentation time of the current frame in seconds
+
+	int getWidth() const; // coded size of the stream
 	int getHeight() const;
 	double getFrameDelay() const;
 
+	// Per-frame cost of reading packets and decoding (deinterlacing has
+	// its own figure)
+	const StageTiming& getDemuxTiming() const;
+	const StageTiming& getDecodeTiming() const;
+	const Deinterlacer& getDeinterlacer() const;
+
 private:
 	bool decodeNextFrame();
-	void setupSwsContext();
+	bool receiveFrame(double& demux_ms);
+	bool nextSourceFrame(); // decode + optional deinterlace into src_frame
 
 	AVFormatContext* fmt_ctx = nullptr;
 	AVCodecContext* codec_ctx = nullptr;
-	SwsContext* sws_ctx = nullptr;
 
 	AVPacket* packet = nullptr;
 	AVFrame* yuv_frame = nullptr;
-	AVFrame* rgb_frame = nullptr;
+	AVFrame* filtered_frame = nullptr;
+	AVFrame* src_frame = nullptr; // whichever of the two is handed out
+
+	Deinterlacer deinterlacer;
+	bool deinterlace_enabled = true;
+	bool filter_flushed = false;
+
+	double frame_pts = 0.0;
 
-	uint8_t* rgb_buffer = nullptr;
+	StageTiming demux_timing;
+	StageTiming decode_timing;
 
 	int video_stream_index = -1;
 	double frame_delay = 0.0;
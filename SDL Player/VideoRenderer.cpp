@@ -1,4 +1,7 @@
 #include "VideoRenderer.h"
+#include "ShaderProgram.h"
+#include <chrono>
+#include <cstring>
 #include <iostream>
 
 const char* vertexShaderSource = R"(
@@ -8,9 +11,12 @@ layout (location = 1) in vec2 aTexCoord;
 
 out vec2 TexCoord;
 
+// set when sampling something we rendered ourselves (bottom-up rows)
+uniform bool uFlipY;
+
 void main() {
     gl_Position = vec4(aPos, 0.0, 1.0);
-    TexCoord = aTexCoord;
+    TexCoord = uFlipY ? vec2(aTexCoord.x, 1.0 - aTexCoord.y) : aTexCoord;
 }
 )";
 
@@ -26,45 +32,150 @@ void main() {
 }
 )";
 
-static GLuint compileShader(GLenum type, const char* src) {
-    GLuint shader = glCreateShader(type);
-    glShaderSource(shader, 1, &src, nullptr);
-    glCompileShader(shader);
+// Catmull-Rom over a 4x4 neighbourhood, sharper than bilinear when enlarging
+const char* bicubicFragmentShaderSource = R"(
+#version 460 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+uniform sampler2D uTexture;
+
+vec4 cubicWeights(float t) {
+    float t2 = t * t;
+    float t3 = t2 * t;
+    return vec4(
+        -0.5 * t3 + t2 - 0.5 * t,
+         1.5 * t3 - 2.5 * t2 + 1.0,
+        -1.5 * t3 + 2.0 * t2 + 0.5 * t,
+         0.5 * t3 - 0.5 * t2);
+}
+
+void main() {
+    ivec2 size = textureSize(uTexture, 0);
+    vec2 pos = TexCoord * vec2(size) - 0.5;
+    vec2 base = floor(pos);
+    vec4 wx = cubicWeights(pos.x - base.x);
+    vec4 wy = cubicWeights(pos.y - base.y);
+
+    vec4 color = vec4(0.0);
+    for (int j = 0; j < 4; ++j) {
+        vec4 row = vec4(0.0);
+        for (int i = 0; i < 4; ++i) {
+            ivec2 p = clamp(ivec2(base) + ivec2(i - 1, j - 1), ivec2(0), size - 1);
+            row += texelFetch(uTexture, p, 0) * wx[i];
+        }
+        color += row * wy[j];
+    }
+    FragColor = clamp(color, 0.0, 1.0);
+}
+)";
+
+// One separable Lanczos-3 pass, run horizontally into an intermediate
+// texture and then vertically onto the screen
+const char* lanczosFragmentShaderSource = R"(
+#version 460 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+uniform sampler2D uTexture;
+uniform ivec2 uDirection; // (1,0) horizontal pass, (0,1) vertical pass
+uniform float uScale;     // source / destination length along the pass
+
+const float PI = 3.14159265;
+const int RADIUS = 3;
+const int MAX_TAPS = 32;
+
+float lanczos(float x) {
+    if (abs(x) < 1e-5) return 1.0;
+    if (abs(x) >= float(RADIUS)) return 0.0;
+    float px = PI * x;
+    return float(RADIUS) * sin(px) * sin(px / float(RADIUS)) / (px * px);
+}
+
+void main() {
+    ivec2 size = textureSize(uTexture, 0);
+    vec2 pos = TexCoord * vec2(size);
+
+    // Only the pass direction is resampled, the other axis maps 1:1
+    int len = uDirection.x == 1 ? size.x : size.y;
+    float center = (uDirection.x == 1 ? pos.x : pos.y) - 0.5;
+    ivec2 across = clamp(ivec2(floor(pos)), ivec2(0), size - 1) * (ivec2(1) - uDirection);
 
-    int success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        char log[512];
-        glGetShaderInfoLog(shader, 512, nullptr, log);
-        std::cerr << "Shader compile error:\n" << log << "\n";
+    // Widen the kernel when shrinking so it still low-passes properly
+    float filterScale = max(uScale, 1.0);
+    int support = min(int(ceil(float(RADIUS) * filterScale)), MAX_TAPS / 2);
+    int first = int(floor(center)) - support + 1;
+
+    vec4 color = vec4(0.0);
+    float total = 0.0;
+    for (int i = 0; i < MAX_TAPS; ++i) {
+        if (i >= 2 * support) break;
+        int x = first + i;
+        float w = lanczos((float(x) - center) / filterScale);
+        color += texelFetch(uTexture, across + uDirection * clamp(x, 0, len - 1), 0) * w;
+        total += w;
+    }
+    FragColor = clamp(color / total, 0.0, 1.0);
+}
+)";
+
+const char* VideoRenderer::scaleFilterName(ScaleFilter filter) {
+    switch (filter) {
+    case SCALE_BILINEAR: return "bilinear";
+    case SCALE_BICUBIC: return "bicubic";
+    case SCALE_LANCZOS: return "lanczos";
+    default: return "unknown";
     }
-    return shader;
 }
 
-VideoRenderer::VideoRenderer(int w, int h)
-    : width(w), height(h)
+VideoRenderer::VideoRenderer(int w, int h, int textureRingDepth)
+    : width(w), height(h), viewWidth(w), viewHeight(h), windowWidth(w), windowHeight(h)
 {
+    // 1 means a single texture, rewritten while it may still be in use
+    if (textureRingDepth < 1) textureRingDepth = 1;
+    if (textureRingDepth > kMaxTextureRingDepth) textureRingDepth = kMaxTextureRingDepth;
+    textureCount = textureRingDepth;
+
     initGLObjects();
 }
 
 VideoRenderer::~VideoRenderer() {
-    glDeleteTextures(1, &textureID);
-    glDeleteProgram(shaderProgram);
+    freePbos();
+    glDeleteTextures(textureCount, textures);
+    glDeleteFramebuffers(1, &scaleFbo);
+    glDeleteTextures(1, &scaleTexture);
+    for (int i = 0; i < SCALE_FILTER_COUNT; ++i) {
+        glDeleteProgram(programs[i]);
+    }
     glDeleteBuffers(1, &VBO);
     glDeleteVertexArrays(1, &VAO);
 }
 
-void VideoRenderer::initGLObjects() {
-    // shaders
-    GLuint vs = compileShader(GL_VERTEX_SHADER, vertexShaderSource);
-    GLuint fs = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
+void VideoRenderer::ensureProgram(ScaleFilter filter) {
+    if (programs[filter]) {
+        return;
+    }
 
-    shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vs);
-    glAttachShader(shaderProgram, fs);
-    glLinkProgram(shaderProgram);
-    glDeleteShader(vs);
-    glDeleteShader(fs);
+    static const char* fragmentSources[SCALE_FILTER_COUNT] = {
+        fragmentShaderSource,
+        bicubicFragmentShaderSource,
+        lanczosFragmentShaderSource,
+    };
+    programs[filter] = linkProgram(vertexShaderSource, fragmentSources[filter]);
+    flipLocs[filter] = glGetUniformLocation(programs[filter], "uFlipY");
+    if (filter == SCALE_LANCZOS) {
+        lanczosDirectionLoc = glGetUniformLocation(programs[SCALE_LANCZOS], "uDirection");
+        lanczosScaleLoc = glGetUniformLocation(programs[SCALE_LANCZOS], "uScale");
+    }
+}
+
+void VideoRenderer::initGLObjects() {
+    // Every filter is linked here, at startup with the context current and
+    // the shader cache open, so switching filters never stalls a frame on
+    // a compile. With a warm cache these are binary loads.
+    for (int i = 0; i < SCALE_FILTER_COUNT; ++i) {
+        ensureProgram((ScaleFilter)i);
+    }
 
     // Fullscreen quad
     float quadVertices[] = {
@@ -99,35 +210,338 @@ void VideoRenderer::initGLObjects() {
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
     glEnableVertexAttribArray(1);
 
-    //texture
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
+    //textures
+    allocateTextures();
 
-    // Texture settings
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindVertexArray(0);
+    glDeleteBuffers(1, &EBO);
+}
+
+void VideoRenderer::allocateTextures() {
+    // Immutable storage can't be resized, so a new size means new textures
+    if (textures[0]) {
+        glDeleteTextures(textureCount, textures);
+    }
+    glGenTextures(textureCount, textures);
+
+    for (int i = 0; i < textureCount; ++i) {
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+
+        // Texture settings
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+    }
+
+    writeIndex = 0;
+    displayIndex = 0;
+}
+
+void VideoRenderer::resize(int w, int h) {
+    if (w == width && h == height) {
+        return;
+    }
+
+    // Only the textures are replaced; shaders, buffers and the VAO stay as they are
+    width = w;
+    height = h;
+    allocateTextures();
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void VideoRenderer::setViewport(int w, int h) {
+    windowWidth = w;
+    windowHeight = h;
+    updateViewport();
+}
+
+void VideoRenderer::setDisplayAspect(double aspect) {
+    if (aspect == displayAspect) {
+        return;
+    }
+    displayAspect = aspect;
+    updateViewport();
+}
+
+void VideoRenderer::setRenderTarget(GLuint framebuffer) {
+    outputFramebuffer = framebuffer;
+}
+
+void VideoRenderer::setScaleFilter(ScaleFilter filter) {
+    ensureProgram(filter);
+    scaleFilter = filter;
+}
+
+ScaleFilter VideoRenderer::getScaleFilter() const {
+    return scaleFilter;
+}
+
+void VideoRenderer::updateViewport() {
+    // Fit the picture inside the window at its display aspect; the rest is
+    // left as the clear colour (letterbox top/bottom, pillarbox left/right)
+    double aspect = displayAspect > 0.0 ? displayAspect : (double)width / height;
+    viewWidth = windowWidth;
+    viewHeight = (int)(windowWidth / aspect + 0.5);
+    if (viewHeight > windowHeight) {
+        viewHeight = windowHeight;
+        viewWidth = (int)(windowHeight * aspect + 0.5);
+    }
+    if (viewWidth < 1) viewWidth = 1;
+    if (viewHeight < 1) viewHeight = 1;
+    viewX = (windowWidth - viewWidth) / 2;
+    viewY = (windowHeight - viewHeight) / 2;
+}
+
+bool VideoRenderer::ensureScaleTarget(int w, int h) {
+    if (scaleFbo && w == scaleTextureWidth && h == scaleTextureHeight) {
+        return true;
+    }
+
+    if (!scaleFbo) {
+        glGenFramebuffers(1, &scaleFbo);
+    }
+    glDeleteTextures(1, &scaleTexture);
+    glGenTextures(1, &scaleTexture);
+    glBindTexture(GL_TEXTURE_2D, scaleTexture);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, w, h);
 
-    // Allocate texture space
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height,
-        0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    glBindFramebuffer(GL_FRAMEBUFFER, scaleFbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, scaleTexture, 0);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindVertexArray(0);
-    glDeleteBuffers(1, &EBO);
+    if (!complete) {
+        std::cerr << "Scaling framebuffer incomplete, falling back to bilinear\n";
+        scaleFilter = SCALE_BILINEAR;
+        return false;
+    }
+
+    scaleTextureWidth = w;
+    scaleTextureHeight = h;
+    return true;
+}
+
+bool VideoRenderer::waitForPbo(int index, GLuint64 timeoutNs) {
+    if (!pboFences[index]) {
+        return true;
+    }
+
+    GLenum result = glClientWaitSync(pboFences[index], GL_SYNC_FLUSH_COMMANDS_BIT, timeoutNs);
+    if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) {
+        glDeleteSync(pboFences[index]);
+        pboFences[index] = nullptr;
+        return true;
+    }
+
+    // The GPU may still be reading the slot, so the fence stays and the
+    // slot isn't handed out until it signals
+    return false;
+}
+
+bool VideoRenderer::allocatePbos(GLsizeiptr size) {
+    freePbos();
+
+    // Immutable storage mapped once for its whole lifetime. Coherent means
+    // CPU writes are visible to the GPU without an explicit flush; the
+    // fences are what keep us from overwriting a slot still being read.
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glGenBuffers(kPboCount, pbos);
+    for (int i = 0; i < kPboCount; ++i) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[i]);
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+        pboPtrs[i] = (uint8_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+        if (!pboPtrs[i]) {
+            std::cerr << "Failed to map upload buffer, falling back to direct uploads\n";
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            freePbos();
+            return false;
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    pboCapacity = size;
+    pboIndex = 0;
+    return true;
+}
+
+void VideoRenderer::freePbos() {
+    if (!pbos[0]) {
+        return;
+    }
+
+    for (int i = 0; i < kPboCount; ++i) {
+        if (pboFences[i]) {
+            glDeleteSync(pboFences[i]);
+            pboFences[i] = nullptr;
+        }
+        if (pboPtrs[i]) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[i]);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            pboPtrs[i] = nullptr;
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(kPboCount, pbos);
+    for (int i = 0; i < kPboCount; ++i) {
+        pbos[i] = 0;
+    }
+    pboCapacity = 0;
+}
+
+void VideoRenderer::setPboUploadsEnabled(bool enabled) {
+    pboUploads = enabled;
+    if (!enabled) {
+        freePbos();
+    }
 }
 
-void VideoRenderer::uploadFrame(uint8_t* data) {
-    glBindTexture(GL_TEXTURE_2D, textureID);
+uint8_t* VideoRenderer::acquireUploadBuffer(int linesize) {
+    if (!pboUploads) {
+        return nullptr;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Buffer storage is immutable, so growing means new buffers
+    GLsizeiptr size = (GLsizeiptr)linesize * height;
+    if (size > pboCapacity && !allocatePbos(size)) {
+        return nullptr;
+    }
+
+    // Already timed out once this frame: it goes up from client memory
+    if (pboStalled) {
+        return nullptr;
+    }
+
+    // Wait until the GPU has finished copying out of this slot. Normally
+    // signalled long ago: the ring is deeper than the GPU's backlog.
+    if (!waitForPbo(pboIndex, kPboWaitNs)) {
+        // Move on to any other slot that's free by now rather than sit on
+        // the stuck one; if none is, skip the ring for the rest of the frame
+        int stuck = pboIndex;
+        for (int i = 1; i < kPboCount && pboIndex == stuck; ++i) {
+            int next = (stuck + i) % kPboCount;
+            if (waitForPbo(next, 0)) {
+                pboIndex = next;
+            }
+        }
+        if (pboIndex == stuck) {
+            std::cerr << "Timed out waiting for upload buffers, uploading this frame directly\n";
+            pboStalled = true;
+            return nullptr;
+        }
+        std::cerr << "Timed out waiting for upload buffer " << stuck << ", using " << pboIndex << "\n";
+    }
+
+    pendingLinesize = linesize;
+    acquireMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return pboPtrs[pboIndex];
+}
+
+void VideoRenderer::commitUpload() {
+    if (pendingLinesize == 0) {
+        return;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    glBindTexture(GL_TEXTURE_2D, textures[writeIndex]);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[pboIndex]);
+
+    // BGRA rows are always 4-byte aligned; the row length lets GL skip
+    // any padding itself instead of us repacking on the CPU
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, pendingLinesize / 4);
+
+    // GL_BGRA + 8_8_8_8_REV is the drivers' native layout, so no swizzle on upload.
+    // The source is the bound buffer, so this is a GPU-side copy.
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height,
+        GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, nullptr);
+
+    pboFences[pboIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    pboIndex = (pboIndex + 1) % kPboCount;
+    pendingLinesize = 0;
+    advanceTextureRing();
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    // Fence wait plus the GL calls; filling the buffer is the caller's cost
+    uploadTiming.add(acquireMs +
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+}
+
+void VideoRenderer::uploadFrame(const uint8_t* data, int linesize) {
+    // Frames that live in client memory still go through the staging ring,
+    // unless it already timed out for this frame
+    uint8_t* dst = acquireUploadBuffer(linesize);
+    if (dst) {
+        memcpy(dst, data, (size_t)linesize * height);
+        commitUpload();
+        return;
+    }
+
+    ScopedStageTimer timer(uploadTiming);
+    glBindTexture(GL_TEXTURE_2D, textures[writeIndex]);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, linesize / 4);
     glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height,
-        GL_RGB, GL_UNSIGNED_BYTE, data);
+        GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, data);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    advanceTextureRing();
+    pboStalled = false; // the next frame tries the ring again
+}
 
+void VideoRenderer::advanceTextureRing() {
+    // The texture just written becomes the one drawn; the next upload goes
+    // to the oldest one, which the GPU has had the longest to finish with
+    displayIndex = writeIndex;
+    writeIndex = (writeIndex + 1) % textureCount;
 }
 
 void VideoRenderer::render() {
-    glUseProgram(shaderProgram);
     glBindVertexArray(VAO);
-    glBindTexture(GL_TEXTURE_2D, textureID);
+
+    if (scaleFilter == SCALE_LANCZOS && ensureScaleTarget(viewWidth, height)) {
+        // Pass 1: resample horizontally into a viewWidth x height texture
+        glUseProgram(programs[SCALE_LANCZOS]);
+        glBindFramebuffer(GL_FRAMEBUFFER, scaleFbo);
+        glViewport(0, 0, viewWidth, height);
+        glBindTexture(GL_TEXTURE_2D, textures[displayIndex]);
+        glUniform1i(flipLocs[SCALE_LANCZOS], GL_FALSE);
+        glUniform2i(lanczosDirectionLoc, 1, 0);
+        glUniform1f(lanczosScaleLoc, (float)width / viewWidth);
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+        // Pass 2: resample vertically onto the screen
+        glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+        glViewport(viewX, viewY, viewWidth, viewHeight);
+        glBindTexture(GL_TEXTURE_2D, scaleTexture);
+        glUniform1i(flipLocs[SCALE_LANCZOS], GL_TRUE);
+        glUniform2i(lanczosDirectionLoc, 0, 1);
+        glUniform1f(lanczosScaleLoc, (float)height / viewHeight);
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        return;
+    }
+
+    // Single-pass filters (Lanczos falls back to bilinear if its target failed)
+    glUseProgram(programs[scaleFilter]);
+    glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+    glViewport(viewX, viewY, viewWidth, viewHeight);
+    glBindTexture(GL_TEXTURE_2D, textures[displayIndex]);
+    glUniform1i(flipLocs[scaleFilter], GL_FALSE);
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+}
+
+const StageTiming& VideoRenderer::getUploadTiming() const {
+    return uploadTiming;
 }
\ No newline at end of file
@@ -3,19 +3,91 @@
 #include <glad/glad.h>
 #include <cstdint>
 
+#include "PlaybackStats.h"
+
+// GPU scaling filter used when drawing the frame into the window
+enum ScaleFilter {
+	SCALE_BILINEAR,
+	SCALE_BICUBIC,
+	SCALE_LANCZOS, // separable two-pass
+	SCALE_FILTER_COUNT
+};
+
 class VideoRenderer {
 public:
-	VideoRenderer(int width, int height);
+	// textureRingDepth: how many frame textures to rotate through so the one
+	// being written is never the one being drawn
+	VideoRenderer(int width, int height, int textureRingDepth = 3);
 	~VideoRenderer();
 
-	void uploadFrame(uint8_t* data); // uploads raw RGB frame data
+	void resize(int width, int height); // reallocates the texture if the frame size changed
+	void uploadFrame(const uint8_t* data, int linesize); // uploads BGRA frame data with any row stride
 	void render();                   // draws the texture to the screen
 
+	void setViewport(int windowWidth, int windowHeight); // call on every window resize
+	void setDisplayAspect(double aspect); // width / height the picture should be shown at
+	void setRenderTarget(GLuint framebuffer); // 0 = the window, anything else e.g. an offscreen FBO
+	void setScaleFilter(ScaleFilter filter);
+	ScaleFilter getScaleFilter() const;
+	static const char* scaleFilterName(ScaleFilter filter);
+
+	// Zero-copy path: returns persistently mapped staging memory for one
+	// BGRA frame with the given stride, or nullptr if there is none (or the
+	// ring timed out, in which case uploadFrame() goes direct). Fill it,
+	// then commitUpload() turns it into a GPU-side buffer -> texture copy.
+	uint8_t* acquireUploadBuffer(int linesize);
+	void commitUpload();
+	void setPboUploadsEnabled(bool enabled); // false = always upload from client memory, for comparison
+
+	const StageTiming& getUploadTiming() const; // render-thread time spent uploading
+
 private:
 	void initGLObjects();
+	void ensureProgram(ScaleFilter filter);
+	void allocateTextures();
+	void advanceTextureRing();
+	void updateViewport();
+	bool ensureScaleTarget(int width, int height);
+	bool waitForPbo(int index, GLuint64 timeoutNs);
+	bool allocatePbos(GLsizeiptr size);
+	void freePbos();
+
+	// Staging buffers: the CPU (or swscale) fills one while the GPU is still
+	// pulling the previous frame out of another.
+	static const int kPboCount = 3;
+	static const GLuint64 kPboWaitNs = 100000000; // 100 ms
+	static const int kMaxTextureRingDepth = 8;
 
 	int width, height;
-	GLuint textureID = 0;
+	GLuint textures[kMaxTextureRingDepth] = {};
+	int textureCount = 1;
+	int writeIndex = 0;   // next upload target
+	int displayIndex = 0; // most recently completed upload
+	GLuint pbos[kPboCount] = {};
+	GLsync pboFences[kPboCount] = {};
+	uint8_t* pboPtrs[kPboCount] = {}; // persistent coherent mappings
+	GLsizeiptr pboCapacity = 0;
+	int pboIndex = 0;
+	bool pboUploads = true;
+	bool pboStalled = false; // a wait timed out; the current frame bypasses the ring
+	int pendingLinesize = 0; // stride of the acquired slot, 0 if none
+	double acquireMs = 0.0;
+	StageTiming uploadTiming;
 	GLuint VAO = 0, VBO = 0;
-	GLuint shaderProgram = 0;
+	GLuint programs[SCALE_FILTER_COUNT] = {};
+	GLint flipLocs[SCALE_FILTER_COUNT] = {};
+	GLint lanczosDirectionLoc = -1;
+	GLint lanczosScaleLoc = -1;
+	ScaleFilter scaleFilter = SCALE_BILINEAR;
+
+	// letterboxed picture rectangle inside the window
+	int viewX = 0, viewY = 0, viewWidth, viewHeight;
+	int windowWidth, windowHeight;
+	double displayAspect = 0.0; // 0 = frame width / height
+	GLuint outputFramebuffer = 0;
+
+	// intermediate target for the horizontal Lanczos pass
+	GLuint scaleFbo = 0;
+	GLuint scaleTexture = 0;
+	int scaleTextureWidth = 0, scaleTextureHeight = 0;
 };
\ No newline at end of file
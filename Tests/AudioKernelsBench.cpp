@@ -0,0 +1,159 @@
+#include "Tests.h"
+#include "AudioKernels.h"
+#include "AudioKernelsImpl.h"
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <vector>
+
+#ifdef TESTS_WITH_SWRESAMPLE
+extern "C" {
+#include <libavutil/channel_layout.h>
+#include <libavutil/opt.h>
+#include <libswresample/swresample.h>
+}
+#endif
+
+namespace {
+
+const int kMaxTables = 8;
+const int kChannels = 2;
+const size_t kFrames = 1024; // about one device callback's worth at 48 kHz
+const size_t kSamples = kFrames * kChannels;
+const double kSecondsPerKernel = 0.1;
+
+// Best of several runs of 'body' on one block, in millions of samples per
+// second. The best is the least disturbed by the scheduler.
+double Measure(const std::function<void()>& body) {
+    typedef std::chrono::steady_clock Clock;
+    double best = 0.0;
+    Clock::time_point end = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(kSecondsPerKernel));
+    while (Clock::now() < end) {
+        const int reps = 64;
+        Clock::time_point start = Clock::now();
+        for (int r = 0; r < reps; ++r) {
+            body();
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        double rate = reps * (double)kSamples / seconds / 1.0e6;
+        best = rate > best ? rate : best;
+    }
+    return best;
+}
+
+#ifdef TESTS_WITH_SWRESAMPLE
+// What AudioDecoder does with the commonest decoder output (48 kHz stereo
+// FLTP) when the device takes the same rate and layout: swr_convert, or
+// the passthrough kernels. Reported as CPU ms per hour of audio.
+void BenchPassthroughVsSwr(const float* const* planes) {
+    const int kRate = 48000;
+    const double samplesPerHour = (double)kRate * 3600.0 * kChannels;
+    std::vector<float> flt(kSamples);
+    std::vector<int16_t> s16(kSamples);
+
+    struct Case {
+        const char* name;
+        AVSampleFormat out_fmt;
+        std::function<void()> kernel;
+    };
+    const Case cases[] = {
+        { "FLTP -> FLT", AV_SAMPLE_FMT_FLT, [&]() { InterleaveFloat(planes, kChannels, kFrames, flt.data()); } },
+        { "FLTP -> S16", AV_SAMPLE_FMT_S16, [&]() { InterleaveFloatToS16(planes, kChannels, kFrames, s16.data()); } },
+    };
+
+    std::printf("\n  48 kHz stereo FLTP, CPU ms per hour of audio\n");
+    std::printf("  %-22s%12s%12s\n", "", "swresample", "kernels");
+    for (const Case& c : cases) {
+        AVChannelLayout layout = AV_CHANNEL_LAYOUT_STEREO;
+        SwrContext* swr = nullptr;
+        if (swr_alloc_set_opts2(&swr, &layout, c.out_fmt, kRate,
+            &layout, AV_SAMPLE_FMT_FLTP, kRate, 0, nullptr) < 0 || swr_init(swr) < 0) {
+            std::printf("  %-22sswr_init failed\n", c.name);
+            swr_free(&swr);
+            continue;
+        }
+        uint8_t* out = c.out_fmt == AV_SAMPLE_FMT_FLT ? (uint8_t*)flt.data() : (uint8_t*)s16.data();
+        const uint8_t* in[kChannels] = { (const uint8_t*)planes[0], (const uint8_t*)planes[1] };
+
+        double swrRate = Measure([&]() { swr_convert(swr, &out, (int)kFrames, in, (int)kFrames); });
+        double kernelRate = Measure(c.kernel);
+        swr_free(&swr);
+
+        // Msamples/s -> ms to get through an hour's worth
+        std::printf("  %-22s%12.1f%12.1f\n", c.name,
+            samplesPerHour / (swrRate * 1.0e6) * 1000.0,
+            samplesPerHour / (kernelRate * 1.0e6) * 1000.0);
+    }
+}
+#endif
+
+} // namespace
+
+bool RunAudioKernelBench() {
+    AudioKernelTable tables[kMaxTables];
+    int count = GetAvailableAudioKernels(tables, kMaxTables);
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> interleaved(kSamples), scratch(kSamples);
+    std::vector<float> left(kFrames), right(kFrames), outLeft(kFrames), outRight(kFrames);
+    std::vector<int16_t> s16(kSamples);
+    std::vector<int32_t> s32(kSamples);
+    for (size_t i = 0; i < kFrames; ++i) {
+        left[i] = dist(rng);
+        right[i] = dist(rng);
+    }
+    for (float& sample : interleaved) {
+        sample = dist(rng);
+    }
+    const float* planes[kChannels] = { left.data(), right.data() };
+    float* outPlanes[kChannels] = { outLeft.data(), outRight.data() };
+    const float swapMatrix[kChannels * kChannels] = { 0.7f, 0.3f, 0.3f, 0.7f };
+    AudioDither dither;
+    InitAudioDither(dither, 1);
+
+    std::printf("  Msamples/s, %d-channel blocks of %zu frames\n", kChannels, kFrames);
+    std::printf("  %-22s", "");
+    for (int t = 0; t < count; ++t) {
+        std::printf("%10s", tables[t].name);
+    }
+    std::printf("\n");
+
+    struct Row {
+        const char* name;
+        std::function<void(const AudioKernelTable&)> run;
+    };
+    const Row rows[] = {
+        { "interleaveFloat", [&](const AudioKernelTable& k) { k.interleaveFloat(planes, kChannels, kFrames, scratch.data()); } },
+        { "deinterleaveFloat", [&](const AudioKernelTable& k) { k.deinterleaveFloat(interleaved.data(), kChannels, kFrames, outPlanes); } },
+        { "interleaveFloatToS16", [&](const AudioKernelTable& k) { k.interleaveFloatToS16(planes, kChannels, kFrames, s16.data()); } },
+        { "floatToS16", [&](const AudioKernelTable& k) { k.floatToS16(interleaved.data(), kSamples, s16.data()); } },
+        { "floatToS32", [&](const AudioKernelTable& k) { k.floatToS32(interleaved.data(), kSamples, s32.data()); } },
+        { "s32ToFloat", [&](const AudioKernelTable& k) { k.s32ToFloat(s32.data(), kSamples, scratch.data()); } },
+        { "floatToS16Dither", [&](const AudioKernelTable& k) { k.floatToS16Dither(interleaved.data(), kSamples, s16.data(), dither); } },
+        // Ramps up and back down so repeated runs don't drift to 0 or inf
+        { "applyGainRamp", [&](const AudioKernelTable& k) {
+            k.applyGainRamp(scratch.data(), kChannels, kFrames, 0.5f, 2.0f);
+            k.applyGainRamp(scratch.data(), kChannels, kFrames, 2.0f, 0.5f);
+        } },
+        { "mixChannels", [&](const AudioKernelTable& k) { k.mixChannels(planes, kChannels, outPlanes, kChannels, kFrames, swapMatrix); } },
+    };
+
+    for (const Row& row : rows) {
+        std::printf("  %-22s", row.name);
+        for (int t = 0; t < count; ++t) {
+            const AudioKernelTable& table = tables[t];
+            std::printf("%10.0f", Measure([&]() { row.run(table); }));
+        }
+        std::printf("\n");
+    }
+
+#ifdef TESTS_WITH_SWRESAMPLE
+    BenchPassthroughVsSwr(planes);
+#else
+    std::printf("\n  swresample comparison skipped (built without TESTS_WITH_SWRESAMPLE)\n");
+#endif
+    return true;
+}
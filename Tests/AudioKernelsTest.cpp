@@ -0,0 +1,295 @@
+#include "Tests.h"
+#include "AudioKernelsImpl.h"
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+
+const int kMaxTables = 8;
+
+// Longest vector step is 16 samples (AVX2 S16 packing); every length up to
+// a few steps past that hits each tail size at least once
+const size_t kMaxShortLength = 40;
+const size_t kLongLengths[] = { 1000, 1027 };
+
+// Values that sit on a clamp, a rounding tie or outside the normal range
+std::vector<float> EdgeValues() {
+    const float inf = std::numeric_limits<float>::infinity();
+    return {
+        0.0f, -0.0f, 1.0f, -1.0f, 0.99999994f, -0.99999994f, 1.0000001f, -1.0000001f,
+        0.5f / 32768.0f, 1.5f / 32768.0f, -2.5f / 32768.0f, 32767.5f / 32768.0f,
+        1.0e-40f, 2.0f, -2.0f, 1.0e10f, -1.0e10f, inf, -inf,
+        std::numeric_limits<float>::quiet_NaN(),
+    };
+}
+
+// Random samples with the edge values scattered through, so they land in
+// both the vector body and the scalar tail
+std::vector<float> MakeSamples(size_t count, std::mt19937& rng) {
+    std::uniform_real_distribution<float> dist(-1.2f, 1.2f);
+    std::vector<float> edges = EdgeValues();
+    std::vector<float> samples(count);
+    for (size_t i = 0; i < count; ++i) {
+        samples[i] = (rng() % 4 == 0) ? edges[rng() % edges.size()] : dist(rng);
+    }
+    return samples;
+}
+
+std::vector<size_t> TestLengths() {
+    std::vector<size_t> lengths;
+    for (size_t n = 0; n <= kMaxShortLength; ++n) {
+        lengths.push_back(n);
+    }
+    for (size_t n : kLongLengths) {
+        lengths.push_back(n);
+    }
+    return lengths;
+}
+
+bool SameFloat(float a, float b) {
+    return (std::isnan(a) && std::isnan(b)) || a == b;
+}
+
+bool CloseFloat(float a, float b, float magnitude) {
+    if (std::isnan(a) || std::isnan(b) || std::isinf(a) || std::isinf(b)) {
+        return SameFloat(a, b);
+    }
+    return std::fabs(a - b) <= 1.0e-6f * magnitude + 1.0e-30f;
+}
+
+class Checker {
+public:
+    explicit Checker(const char* table_name) : name(table_name) {}
+
+    // Prints the first few failures per table; the count says the rest
+    template <typename T>
+    void fail(const char* kernel, size_t length, size_t index, T got, T expected) {
+        if (++failures <= 10) {
+            std::cerr << "  " << name << " " << kernel << " length " << length << " [" << index << "]: got "
+                << got << ", expected " << expected << "\n";
+        }
+    }
+
+    bool passed() const { return failures == 0; }
+    int failureCount() const { return failures; }
+
+private:
+    const char* name;
+    int failures = 0;
+};
+
+// The fixed points every path must agree on, scalar included
+void CheckEdges(const AudioKernelTable& table, Checker& check) {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float inf = std::numeric_limits<float>::infinity();
+    // Padded to 16 so the vector paths see them too, not only their tails
+    const float src[16] = { 1.0f, -1.0f, nan, 0.0f, inf, -inf, 2.0f, -2.0f,
+        1.0f, -1.0f, nan, 0.0f, inf, -inf, 2.0f, -2.0f };
+    const int16_t s16[4] = { 32767, -32768, 0, 0 };
+    const int32_t s32[4] = { INT32_MAX, INT32_MIN, 0, 0 };
+
+    int16_t out16[16];
+    int32_t out32[16];
+    table.floatToS16(src, 16, out16);
+    table.floatToS32(src, 16, out32);
+    for (int i = 0; i < 16; ++i) {
+        int16_t want16 = i % 8 < 4 ? s16[i % 8] : (i % 8 == 4 || i % 8 == 6 ? 32767 : -32768);
+        int32_t want32 = i % 8 < 4 ? s32[i % 8] : (i % 8 == 4 || i % 8 == 6 ? INT32_MAX : INT32_MIN);
+        if (out16[i] != want16) {
+            check.fail("floatToS16 edge", 16, i, out16[i], want16);
+        }
+        if (out32[i] != want32) {
+            check.fail("floatToS32 edge", 16, i, out32[i], want32);
+        }
+    }
+}
+
+void CheckInterleave(const AudioKernelTable& table, const AudioKernelTable& ref, Checker& check, std::mt19937& rng) {
+    for (int channels = 1; channels <= 8; ++channels) {
+        for (size_t frames : TestLengths()) {
+            std::vector<std::vector<float>> planes(channels);
+            std::vector<const float*> in(channels);
+            for (int c = 0; c < channels; ++c) {
+                planes[c] = MakeSamples(frames, rng);
+                in[c] = planes[c].data();
+            }
+            size_t samples = frames * channels;
+
+            std::vector<float> got(samples), want(samples);
+            table.interleaveFloat(in.data(), channels, frames, got.data());
+            ref.interleaveFloat(in.data(), channels, frames, want.data());
+            for (size_t i = 0; i < samples; ++i) {
+                if (!SameFloat(got[i], want[i])) {
+                    check.fail("interleaveFloat", frames, i, got[i], want[i]);
+                }
+            }
+
+            std::vector<int16_t> got16(samples), want16(samples);
+            table.interleaveFloatToS16(in.data(), channels, frames, got16.data());
+            ref.interleaveFloatToS16(in.data(), channels, frames, want16.data());
+            for (size_t i = 0; i < samples; ++i) {
+                if (got16[i] != want16[i]) {
+                    check.fail("interleaveFloatToS16", frames, i, got16[i], want16[i]);
+                }
+            }
+
+            // And back again
+            std::vector<std::vector<float>> gotPlanes(channels, std::vector<float>(frames));
+            std::vector<std::vector<float>> wantPlanes(channels, std::vector<float>(frames));
+            std::vector<float*> gotOut(channels), wantOut(channels);
+            for (int c = 0; c < channels; ++c) {
+                gotOut[c] = gotPlanes[c].data();
+                wantOut[c] = wantPlanes[c].data();
+            }
+            table.deinterleaveFloat(want.data(), channels, frames, gotOut.data());
+            ref.deinterleaveFloat(want.data(), channels, frames, wantOut.data());
+            for (int c = 0; c < channels; ++c) {
+                for (size_t i = 0; i < frames; ++i) {
+                    if (!SameFloat(gotPlanes[c][i], wantPlanes[c][i])) {
+                        check.fail("deinterleaveFloat", frames, i, gotPlanes[c][i], wantPlanes[c][i]);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void CheckConversions(const AudioKernelTable& table, const AudioKernelTable& ref, Checker& check, std::mt19937& rng) {
+    for (size_t count : TestLengths()) {
+        std::vector<float> src = MakeSamples(count, rng);
+
+        std::vector<int16_t> got16(count), want16(count);
+        table.floatToS16(src.data(), count, got16.data());
+        ref.floatToS16(src.data(), count, want16.data());
+        for (size_t i = 0; i < count; ++i) {
+            if (got16[i] != want16[i]) {
+                check.fail("floatToS16", count, i, got16[i], want16[i]);
+            }
+        }
+
+        // In place, as the header allows for same-size types
+        std::vector<int32_t> want32(count);
+        ref.floatToS32(src.data(), count, want32.data());
+        std::vector<float> inPlace = src;
+        table.floatToS32(inPlace.data(), count, (int32_t*)inPlace.data());
+        const int32_t* got32 = (const int32_t*)inPlace.data();
+        for (size_t i = 0; i < count; ++i) {
+            if (got32[i] != want32[i]) {
+                check.fail("floatToS32", count, i, got32[i], want32[i]);
+            }
+        }
+
+        std::vector<float> wantFloat(count);
+        ref.s32ToFloat(want32.data(), count, wantFloat.data());
+        table.s32ToFloat((const int32_t*)inPlace.data(), count, inPlace.data());
+        for (size_t i = 0; i < count; ++i) {
+            if (!SameFloat(inPlace[i], wantFloat[i])) {
+                check.fail("s32ToFloat", count, i, inPlace[i], wantFloat[i]);
+            }
+        }
+
+        // The noise sequence differs per path, so check the result is the
+        // plain conversion give or take one LSB of dither
+        AudioDither dither;
+        InitAudioDither(dither, 42);
+        std::vector<int16_t> dithered(count);
+        table.floatToS16Dither(src.data(), count, dithered.data(), dither);
+        for (size_t i = 0; i < count; ++i) {
+            if (std::abs((int)dithered[i] - (int)want16[i]) > 1) {
+                check.fail("floatToS16Dither", count, i, dithered[i], want16[i]);
+            }
+        }
+    }
+}
+
+void CheckGainRamp(const AudioKernelTable& table, const AudioKernelTable& ref, Checker& check, std::mt19937& rng) {
+    for (int channels = 1; channels <= 8; ++channels) {
+        for (size_t frames : TestLengths()) {
+            std::vector<float> got = MakeSamples(frames * channels, rng);
+            std::vector<float> want = got;
+            table.applyGainRamp(got.data(), channels, frames, 0.25f, 1.5f);
+            ref.applyGainRamp(want.data(), channels, frames, 0.25f, 1.5f);
+            for (size_t i = 0; i < got.size(); ++i) {
+                if (!CloseFloat(got[i], want[i], std::fabs(want[i]))) {
+                    check.fail("applyGainRamp", frames, i, got[i], want[i]);
+                }
+            }
+        }
+    }
+}
+
+void CheckMix(const AudioKernelTable& table, const AudioKernelTable& ref, Checker& check, std::mt19937& rng) {
+    std::uniform_real_distribution<float> coefficient(-1.0f, 1.0f);
+    const int layouts[][2] = { { 1, 2 }, { 2, 1 }, { 2, 2 }, { 3, 2 }, { 6, 2 }, { 2, 6 }, { 8, 6 } };
+    for (const int* layout : layouts) {
+        int in_channels = layout[0];
+        int out_channels = layout[1];
+        std::vector<float> matrix(in_channels * out_channels);
+        for (float& m : matrix) {
+            m = coefficient(rng);
+        }
+
+        for (size_t frames : TestLengths()) {
+            std::vector<std::vector<float>> planes(in_channels);
+            std::vector<const float*> in(in_channels);
+            for (int c = 0; c < in_channels; ++c) {
+                planes[c] = MakeSamples(frames, rng);
+                in[c] = planes[c].data();
+            }
+            std::vector<std::vector<float>> gotPlanes(out_channels, std::vector<float>(frames));
+            std::vector<std::vector<float>> wantPlanes(out_channels, std::vector<float>(frames));
+            std::vector<float*> gotOut(out_channels), wantOut(out_channels);
+            for (int o = 0; o < out_channels; ++o) {
+                gotOut[o] = gotPlanes[o].data();
+                wantOut[o] = wantPlanes[o].data();
+            }
+            table.mixChannels(in.data(), in_channels, gotOut.data(), out_channels, frames, matrix.data());
+            ref.mixChannels(in.data(), in_channels, wantOut.data(), out_channels, frames, matrix.data());
+
+            for (int o = 0; o < out_channels; ++o) {
+                for (size_t i = 0; i < frames; ++i) {
+                    // Rounding error scales with the terms, not the sum
+                    float magnitude = 0.0f;
+                    for (int c = 0; c < in_channels; ++c) {
+                        magnitude += std::fabs(matrix[o * in_channels + c] * planes[c][i]);
+                    }
+                    if (!CloseFloat(gotPlanes[o][i], wantPlanes[o][i], 4.0f * magnitude)) {
+                        check.fail("mixChannels", frames, i, gotPlanes[o][i], wantPlanes[o][i]);
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+bool RunAudioKernelTests() {
+    AudioKernelTable tables[kMaxTables];
+    int count = GetAvailableAudioKernels(tables, kMaxTables);
+    const AudioKernelTable& scalar = tables[0];
+    std::cout << "  in use: " << GetAudioKernelsName() << "\n";
+
+    bool passed = true;
+    for (int t = 0; t < count; ++t) {
+        Checker check(tables[t].name);
+        std::mt19937 rng(2024);
+        CheckEdges(tables[t], check);
+        if (t > 0) {
+            CheckInterleave(tables[t], scalar, check, rng);
+            CheckConversions(tables[t], scalar, check, rng);
+            CheckGainRamp(tables[t], scalar, check, rng);
+            CheckMix(tables[t], scalar, check, rng);
+        }
+        std::cout << "  " << tables[t].name << ": " << (check.passed() ? "ok" : "FAILED") << "\n";
+        if (!check.passed()) {
+            std::cerr << "  " << check.failureCount() << " mismatches\n";
+        }
+        passed = check.passed() && passed;
+    }
+    return passed;
+}
@@ -0,0 +1,138 @@
+#include "Tests.h"
+#include "AudioRingBuffer.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Sequence bytes: counter mod a prime, so the pattern never lines up with
+// the ring's capacity or the chunk sizes and a misplaced span shows up
+const uint32_t kPatternPrime = 251;
+
+uint8_t PatternByte(uint64_t index) {
+    return (uint8_t)(index % kPatternPrime);
+}
+
+// One producer and one consumer hammer the ring with random chunk sizes,
+// each alternating between the copying API and the zero-copy acquire/peek
+// API. The consumer checks every byte arrives exactly once and in order.
+bool RunOnce(size_t capacity, uint64_t total_bytes, uint32_t seed) {
+    AudioRingBuffer ring(capacity);
+    std::atomic<bool> failed(false);
+    const size_t max_chunk = capacity + capacity / 2; // sometimes more than fits
+
+    std::thread producer([&]() {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<size_t> chunk_size(1, max_chunk);
+        std::vector<uint8_t> chunk(max_chunk);
+        uint64_t written = 0;
+
+        while (written < total_bytes && !failed.load(std::memory_order_relaxed)) {
+            size_t want = (size_t)std::min<uint64_t>(chunk_size(rng), total_bytes - written);
+            if (rng() & 1) {
+                for (size_t i = 0; i < want; ++i) {
+                    chunk[i] = PatternByte(written + i);
+                }
+                size_t n = ring.write(chunk.data(), want);
+                if (n > want) {
+                    std::cerr << "  write() returned " << n << " for " << want << " bytes\n";
+                    failed = true;
+                }
+                written += n;
+            }
+            else {
+                size_t contiguous;
+                uint8_t* dst = ring.acquireWrite(contiguous);
+                size_t n = std::min(want, contiguous);
+                for (size_t i = 0; i < n; ++i) {
+                    dst[i] = PatternByte(written + i);
+                }
+                ring.commitWrite(n);
+                written += n;
+            }
+            if (ring.writeAvailable() == 0) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::thread consumer([&]() {
+        std::mt19937 rng(seed ^ 0x9e3779b9u);
+        std::uniform_int_distribution<size_t> chunk_size(1, max_chunk);
+        std::vector<uint8_t> chunk(max_chunk);
+        uint64_t read = 0;
+
+        while (read < total_bytes && !failed.load(std::memory_order_relaxed)) {
+            size_t available = ring.readAvailable();
+            if (available > capacity) {
+                std::cerr << "  readAvailable() " << available << " exceeds capacity " << capacity << "\n";
+                failed = true;
+                break;
+            }
+
+            size_t want = chunk_size(rng);
+            const uint8_t* src;
+            size_t n;
+            bool peeked = (rng() & 1) != 0;
+            if (peeked) {
+                size_t contiguous;
+                src = ring.peekRead(contiguous);
+                n = std::min(want, contiguous);
+            }
+            else {
+                n = ring.read(chunk.data(), want);
+                src = chunk.data();
+            }
+
+            for (size_t i = 0; i < n; ++i) {
+                if (src[i] != PatternByte(read + i)) {
+                    std::cerr << "  byte " << (read + i) << ": got " << (int)src[i]
+                        << ", expected " << (int)PatternByte(read + i) << "\n";
+                    failed = true;
+                    break;
+                }
+            }
+            if (peeked) {
+                ring.commitRead(n);
+            }
+            read += n;
+            if (n == 0) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    producer.join();
+    consumer.join();
+
+    if (!failed && ring.size() != 0) {
+        std::cerr << "  " << ring.size() << " bytes left over\n";
+        failed = true;
+    }
+    return !failed;
+}
+
+} // namespace
+
+bool RunAudioRingBufferStress() {
+    // Small and odd capacities wrap constantly; the last is 250 ms of
+    // 48 kHz stereo float, the scale the player runs at
+    const size_t capacities[] = { 1, 7, 64, 4099, 48000 / 4 * 8 };
+    const uint64_t total_bytes = 64ull * 1024 * 1024;
+
+    bool passed = true;
+    uint32_t seed = 12345;
+    for (size_t capacity : capacities) {
+        // Tiny rings move a byte or two per round trip; keep them short
+        uint64_t bytes = capacity < 64 ? total_bytes / 64 : total_bytes;
+        bool ok = RunOnce(capacity, bytes, seed++);
+        std::cout << "  capacity " << capacity << ", " << bytes << " bytes: " << (ok ? "ok" : "FAILED") << "\n";
+        passed = ok && passed;
+    }
+    return passed;
+}
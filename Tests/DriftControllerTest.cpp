@@ -0,0 +1,82 @@
+#include "Tests.h"
+#include "DriftController.h"
+#include <cmath>
+#include <iostream>
+#include <random>
+
+namespace {
+
+// The player's settings (Main.cpp)
+const double kCorrectionSeconds = 10.0;
+const double kMaxPpm = 500.0;
+const double kCheckSeconds = 0.5;
+const int kSampleRate = 48000;
+
+// The resampler takes whole samples of correction over its window
+double RoundLikeSwr(double ppm) {
+    double distance = (double)kSampleRate * kCorrectionSeconds;
+    return std::floor(ppm * 1e-6 * distance + 0.5) * 1e6 / distance;
+}
+
+struct SimResult {
+    double max_ppm;   // largest adjustment applied at any point
+    double mean_ppm;  // over the second half
+    double mean_drift_ms;
+};
+
+// A device whose clock runs 'device_ppm' fast against the system clock,
+// measured every kCheckSeconds with some callback jitter. The audio clock
+// includes the stretch being applied, as MediaClock does with per-batch
+// anchors, so each output second covers 1 / (1 + ppm) seconds of media.
+SimResult Simulate(double device_ppm, double jitter_ms, double seconds) {
+    DriftController controller(kCorrectionSeconds, kMaxPpm);
+    std::mt19937 rng(99);
+    std::normal_distribution<double> jitter(0.0, jitter_ms * 1e-3);
+
+    SimResult result = { 0.0, 0.0, 0.0 };
+    double drift = 0.0;
+    double applied = 0.0;
+    int steps = (int)(seconds / kCheckSeconds);
+    int averaged = 0;
+    for (int i = 1; i <= steps; ++i) {
+        double audio_rate = (1.0 + device_ppm * 1e-6) / (1.0 + applied * 1e-6);
+        drift += (audio_rate - 1.0) * kCheckSeconds;
+
+        uint64_t now_ns = (uint64_t)(i * kCheckSeconds * 1e9);
+        applied = RoundLikeSwr(controller.update(now_ns, drift + jitter(rng)));
+        controller.setApplied(applied);
+
+        result.max_ppm = std::fmax(result.max_ppm, std::fabs(applied));
+        if (i > steps / 2) {
+            result.mean_ppm += applied;
+            result.mean_drift_ms += drift * 1000.0;
+            ++averaged;
+        }
+    }
+    result.mean_ppm /= averaged;
+    result.mean_drift_ms /= averaged;
+    return result;
+}
+
+bool CheckSettles(double device_ppm, double jitter_ms) {
+    SimResult r = Simulate(device_ppm, jitter_ms, 600.0);
+    double expected_drift_ms = device_ppm * 1e-6 * kCorrectionSeconds * 1000.0;
+    bool ok = r.max_ppm < kMaxPpm * 0.5 &&
+        std::fabs(r.mean_ppm - device_ppm) < 10.0 &&
+        std::fabs(r.mean_drift_ms - expected_drift_ms) < 0.25;
+
+    std::cout << "  device " << device_ppm << " ppm, jitter " << jitter_ms << " ms: settled at "
+        << r.mean_ppm << " ppm, drift " << r.mean_drift_ms << " ms, peak " << r.max_ppm << " ppm: "
+        << (ok ? "ok" : "FAILED") << "\n";
+    return ok;
+}
+
+} // namespace
+
+bool RunDriftControllerTests() {
+    bool passed = true;
+    passed = CheckSettles(100.0, 0.0) && passed;
+    passed = CheckSettles(100.0, 0.5) && passed;
+    passed = CheckSettles(-100.0, 0.5) && passed;
+    return passed;
+}
@@ -0,0 +1,30 @@
+#include "Tests.h"
+#include <cstring>
+#include <iostream>
+
+// usage: Tests [ring|kernels|drift|bench]
+// No argument runs every test; the benchmark only runs when asked for.
+int main(int argc, char* argv[]) {
+    const char* only = argc > 1 ? argv[1] : nullptr;
+    bool passed = true;
+
+    if (!only || strcmp(only, "ring") == 0) {
+        std::cout << "AudioRingBuffer stress...\n";
+        passed = RunAudioRingBufferStress() && passed;
+    }
+    if (!only || strcmp(only, "kernels") == 0) {
+        std::cout << "AudioKernels equivalence...\n";
+        passed = RunAudioKernelTests() && passed;
+    }
+    if (!only || strcmp(only, "drift") == 0) {
+        std::cout << "DriftController...\n";
+        passed = RunDriftControllerTests() && passed;
+    }
+    if (only && strcmp(only, "bench") == 0) {
+        std::cout << "AudioKernels benchmark...\n";
+        passed = RunAudioKernelBench() && passed;
+    }
+
+    std::cout << (passed ? "All tests passed\n" : "FAILED\n");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,12 @@
+#ifndef TESTS_H
+#define TESTS_H
+
+/// Each returns true when every check passed; failures are printed to std::cerr.
+bool RunAudioRingBufferStress();
+bool RunAudioKernelTests();   // every SIMD table against the scalar one
+bool RunDriftControllerTests(); // system-clock mode against a simulated device
+
+/// Prints throughput per kernel and implementation; always returns true.
+bool RunAudioKernelBench();
+
+#endif // TESTS_H